@@ -22,18 +22,21 @@ int main() {
     strcpy(buf, "Finish GPID_FILE initialization");
     grass->sys_send(GPID_PROCESS, buf, 32);
 
-    /* Wait for inode read or write requests. */
+    /* Reply to the last request and wait for the next inode read or write
+     * request. There is no request to reply to at the first time. */
+    int sender, client = GPID_UNUSED;
     while (1) {
-        int sender, r;
+        int r;
         struct file_request* req = (void*)buf;
         struct file_reply* reply = (void*)buf;
-        grass->sys_recv(GPID_ALL, &sender, buf, SYSCALL_MSG_LEN);
+        grass->sys_reply_bulk_wait(client, (void*)reply, sizeof(*reply),
+                                   &sender, buf, SYSCALL_MSG_LEN);
 
         switch (req->type) {
         case FILE_READ:
-            r = fs->read(fs, req->ino, req->offset, (void*)&reply->block);
+            r = fs->read(fs, req->ino, req->offset, (void*)SYSCALL_BULK);
             reply->status = r == 0 ? FILE_OK : FILE_ERROR;
-            grass->sys_send(sender, (void*)reply, sizeof(*reply));
+            client        = sender;
             break;
         case FILE_WRITE:
             /* The FILE_WRITE case is left to students as an exercise. */
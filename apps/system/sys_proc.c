@@ -17,18 +17,20 @@ static void sys_spawn(uint base);
 static int app_spawn(struct proc_request* req);
 
 struct multicore {
-    int boot_lock, booted_core_cnt; /* See earth/boot.s */
+    struct spinlock boot_lock;
+    int booted_core_cnt; /* See earth/boot.s */
 };
 
 int main(int unused, struct multicore* boot) {
     SUCCESS("Enter kernel process GPID_PROCESS");
 
-    /* Student's code goes here (Multicore & Locks). */
-
-    /* Release the boot lock, so the other 3 cores can start
-     * to run; Wait for all the 4 cores to finish booting. */
-
-    /* Student's code ends here. */
+    /* Release the boot lock, so the other 3 cores can start to run, and
+     * wait for all the 4 cores to finish booting. The software TLB keeps a
+     * single user address space, so it only runs on the first core. */
+    if (earth->translation == PAGE_TABLE) {
+        release(boot->boot_lock);
+        while (boot->booted_core_cnt < NCORES);
+    }
 
     int sender, shell_waiting;
     char buf[SYSCALL_MSG_LEN];
@@ -43,10 +45,18 @@ int main(int unused, struct multicore* boot) {
 
     sys_spawn(SYS_SHELL_EXEC_START);
 
+    /* Reply to the last request (if it needs a reply) and wait for the next
+     * request with a single system call. */
+    int client = GPID_UNUSED;
+    uint reply_size = 0;
     while (1) {
-        struct proc_request* req = (void*)buf;
-        struct proc_reply* reply = (void*)buf;
-        grass->sys_recv(GPID_ALL, &sender, buf, SYSCALL_MSG_LEN);
+        struct proc_request* req     = (void*)buf;
+        struct proc_reply* reply     = (void*)buf;
+        struct proc_info_reply* info = (void*)buf;
+        grass->sys_reply_wait(client, buf, reply_size, &sender, buf,
+                              SYSCALL_MSG_LEN);
+        client     = GPID_UNUSED;
+        reply_size = sizeof(*reply);
 
         switch (req->type) {
         case PROC_SPAWN:
@@ -56,31 +66,69 @@ int main(int unused, struct multicore* boot) {
                 (req->argv[req->argc - 1][0] != '&') && (reply->type == CMD_OK);
             if (!shell_waiting && reply->type == CMD_OK)
                 INFO("process %d running in the background", app_pid);
-            grass->sys_send(GPID_SHELL, (void*)reply, sizeof(*reply));
+            client = GPID_SHELL;
             break;
         case PROC_EXIT:
             grass->proc_free(sender);
 
             if (shell_waiting && app_pid == sender)
-                grass->sys_send(GPID_SHELL, (void*)reply, sizeof(*reply));
+                client = GPID_SHELL;
             else if (app_pid == sender)
                 INFO("background process %d terminated", sender);
             break;
         case PROC_KILLALL:
             grass->proc_free(GPID_ALL);
             break;
-        /* Student's code goes here (System Call & Protection). */
-
-        /* Add a case which handles process sleep. */
-
-        /* Student's code ends here. */
+        case PROC_INFO:
+            info->nprocs = grass->proc_info(info->procs, PROC_INFO_MAX);
+            reply_size   = sizeof(*info);
+            client       = sender;
+            break;
+        case PROC_SET_AFFINITY:
+            reply->type = grass->proc_set_affinity(req->pid, req->affinity) == 0
+                              ? CMD_OK : CMD_ERROR;
+            client      = sender;
+            break;
         default:
             FATAL("sys_process: invalid request %d", req->type);
         }
     }
 }
 
-static void app_read(uint off, char* dst) { file_read(app_ino, off, dst); }
+/* Read the blocks of an app APP_READ_AHEAD at a time, with one system call
+ * each, since elf_load() reads them one by one and mostly in order. */
+#define APP_READ_AHEAD 8
+static char app_cache[APP_READ_AHEAD * BLOCK_SIZE];
+static uint app_cache_off, app_cache_cnt, app_nblocks;
+
+static void app_read(uint off, char* dst) {
+    if (off == 0) {
+        /* Block 0 is the ELF header, which tells how far to read ahead. */
+        file_read(app_ino, 0, dst);
+        struct elf32_header* header          = (void*)dst;
+        struct elf32_program_header* pheader = (void*)(dst + header->e_phoff);
+
+        app_nblocks = app_cache_cnt = 0;
+        for (uint i = 0; i < header->e_phnum; i++) {
+            uint end = (pheader[i].p_offset + pheader[i].p_filesz + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            if (end > app_nblocks) app_nblocks = end;
+        }
+        return;
+    }
+
+    if (off < app_cache_off || off >= app_cache_off + app_cache_cnt) {
+        uint nblocks  = (off < app_nblocks) ? app_nblocks - off : 0;
+        app_cache_off = off;
+        app_cache_cnt = file_read_batch(app_ino, off,
+                                        nblocks < APP_READ_AHEAD ? nblocks : APP_READ_AHEAD,
+                                        app_cache);
+        if (app_cache_cnt == 0) {
+            file_read(app_ino, off, dst);
+            return;
+        }
+    }
+    memcpy(dst, app_cache + (off - app_cache_off) * BLOCK_SIZE, BLOCK_SIZE);
+}
 
 static int app_spawn(struct proc_request* req) {
     int bin_ino = dir_lookup(0, "bin/");
@@ -89,6 +137,8 @@ static int app_spawn(struct proc_request* req) {
 
     struct process *app = grass->proc_alloc();
     elf_load(app->pid, app_read, argc, (void**)req->argv);
+    if (req->affinity && grass->proc_set_affinity(app->pid, req->affinity) < 0)
+        INFO("sys_process: no booted core in affinity 0x%x", req->affinity);
     grass->proc_set_ready(app);
 
     app_pid = app->pid;
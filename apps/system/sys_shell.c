@@ -24,6 +24,23 @@ int parse_request(char* buf, struct proc_request* req) {
     return 0;
 }
 
+/* `@CORES COMMAND` runs COMMAND only on the cores listed as digits in CORES,
+ * e.g., `@24 loop &` on core #2 and #4; take CORES off argv into affinity. */
+int parse_affinity(struct proc_request* req) {
+    req->affinity = 0;
+    if (req->argv[0][0] != '@') return 0;
+
+    for (char* c = req->argv[0] + 1; *c; c++) {
+        if (*c < '0' || *c > '0' + NCORES) return -1;
+        req->affinity |= (1 << (*c - '0'));
+    }
+    if (req->affinity == 0 || req->argc < 2) return -1;
+
+    memmove(req->argv[0], req->argv[1], (--req->argc) * CMD_ARG_LEN);
+    memset(req->argv[req->argc], 0, CMD_ARG_LEN);
+    return 0;
+}
+
 int main() {
     CRITICAL("Welcome to the egos-2000 shell!");
 
@@ -33,12 +50,13 @@ int main() {
         struct proc_reply reply;
 
         if (strcmp(buf, "coresinfo") == 0) {
-            /* Student's code goes here (Multicore & Locks). */
-
-            /* Add proc_coresinfo() from process.c into the grass interface;
-             * Invoke proc_coresinfo() to show the pid running on each core. */
-
-            /* Student's code ends here. */
+            grass->proc_coresinfo();
+        } else if (strcmp(buf, "schedinfo") == 0) {
+            grass->sched_info();
+        } else if (strcmp(buf, "lockinfo") == 0) {
+            grass->lock_info();
+        } else if (strcmp(buf, "trace") == 0) {
+            grass->trace_dump();
         } else if (strcmp(buf, "killall") == 0) {
             req.type = PROC_KILLALL;
             grass->sys_send(GPID_PROCESS, (void*)&req, sizeof(req));
@@ -50,10 +68,11 @@ int main() {
             req.type = PROC_SPAWN;
             if (0 != parse_request(buf, &req)) {
                 INFO("sys_shell: too many arguments or argument too long");
+            } else if (0 != parse_affinity(&req)) {
+                INFO("sys_shell: usage: @CORES COMMAND, e.g., @24 loop &");
             } else {
-                grass->sys_send(GPID_PROCESS, (void*)&req, sizeof(req));
-                grass->sys_recv(GPID_PROCESS, NULL, (void*)&reply,
-                                sizeof(reply));
+                grass->sys_call(GPID_PROCESS, (void*)&req, sizeof(req),
+                                (void*)&reply, sizeof(reply));
 
                 if (reply.type != CMD_OK)
                     INFO("sys_shell: command %s not found", req.argv[0]);
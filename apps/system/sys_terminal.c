@@ -16,11 +16,16 @@ int main() {
     strcpy(buf, "Finish GPID_TERMINAL initialization");
     grass->sys_send(GPID_PROCESS, buf, 36);
 
+    /* Reply to the last request (if it needs a reply) and wait for the
+     * next request with a single system call. */
+    int sender, client = GPID_UNUSED;
+    uint reply_size = 0;
     while (1) {
-        int sender;
         struct term_request* req = (void*)buf;
         struct term_reply* reply = (void*)buf;
-        grass->sys_recv(GPID_ALL, &sender, (void*)req, SYSCALL_MSG_LEN);
+        grass->sys_reply_wait(client, (void*)reply, reply_size, &sender,
+                              (void*)req, SYSCALL_MSG_LEN);
+        client = GPID_UNUSED;
 
         if (req->len > TERM_BUF_SIZE)
             FATAL("sys_terminal: request len %d>TERM_BUF_SIZE", req->len);
@@ -28,7 +33,8 @@ int main() {
         switch (req->type) {
         case TERM_INPUT:
             reply->len = term_read(reply->buf, req->len);
-            grass->sys_send(sender, (void*)reply, sizeof(*reply));
+            reply_size = sizeof(*reply) - TERM_BUF_SIZE + reply->len;
+            client     = sender;
             break;
         case TERM_OUTPUT:
             term_write(req->buf, req->len);
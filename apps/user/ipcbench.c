@@ -0,0 +1,205 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: IPC latency benchmark
+ * `ipcbench [N]` sends N empty TERM_OUTPUT requests (8 bytes each) to
+ * GPID_TERMINAL and prints the average latency of sys_send in mtime ticks.
+ * `ipcbench park &` blocks in sys_recv forever, adding one process to the
+ * kernel which never runs again. Park a few processes in the background
+ * and run `ipcbench` again; the latency should stay flat.
+ * `ipcbench pong &` echoes every message back to its sender, and
+ * `ipcbench ping PID [N]` does N round trips with the pong process PID,
+ * printing the average round-trip time in mtime ticks.
+ *
+ * To measure the IPC throughput of several cores, `ipcbench tput K &`
+ * coordinates K ping-pong pairs, with each ping started by
+ * `ipcbench ping PID N COORD &` where COORD is the pid of the coordinator.
+ * Once all K pings are ready, the coordinator starts them at once and
+ * prints the round trips per second of all pairs together. For example,
+ * start 4 pongs, then `ipcbench tput 4 &`, then 4 pings.
+ *
+ * `ipcbench switch PID CORE [N]` pins itself and the pong process PID to
+ * CORE, so that every round trip takes two context switches on one core,
+ * and prints the average cost of a switch in mtime ticks. Boot with page
+ * tables, and then with page tables without ASIDs, to compare the cost of
+ * flushing the TLB on every switch.
+ */
+
+#include "app.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PING_LEN 8
+
+static void pong() {
+    int sender;
+    char buf[PING_LEN];
+    while (1) {
+        sys_recv(GPID_ALL, &sender, buf, PING_LEN);
+        /* Tell the sender its pid, which `ipcbench switch` needs. */
+        *(int*)buf = sender;
+        sys_send(sender, buf, PING_LEN);
+    }
+}
+
+static int ping(int pid, uint niters, int coord) {
+    char buf[PING_LEN] = "ping";
+
+    /* Wait for the coordinator to start all pings at the same time. */
+    if (coord) {
+        sys_send(coord, buf, PING_LEN);
+        sys_recv(coord, NULL, buf, PING_LEN);
+    }
+
+    ulonglong start = sys_mtime();
+    for (uint i = 0; i < niters; i++) {
+        sys_send(pid, buf, PING_LEN);
+        sys_recv(pid, NULL, buf, PING_LEN);
+    }
+    ulonglong total = sys_mtime() - start;
+
+    if (coord) {
+        sys_send(coord, (void*)&niters, sizeof(niters));
+        return 0;
+    }
+
+    printf("ipcbench: %d round trips in %d ticks, %d ticks per round trip\r\n",
+           niters, (uint)total, (uint)(total / niters));
+    return 0;
+}
+
+static int pin(int pid, uint affinity) {
+    struct proc_request req;
+    struct proc_reply reply;
+    req.type     = PROC_SET_AFFINITY;
+    req.pid      = pid;
+    req.affinity = affinity;
+    sys_call(GPID_PROCESS, (void*)&req, sizeof(req), (void*)&reply,
+             sizeof(reply));
+    return (reply.type == CMD_OK) ? 0 : -1;
+}
+
+#define WARMUP 100
+
+static int ctx_switch(int pid, uint core, uint niters) {
+    char buf[PING_LEN] = "ping";
+    sys_send(pid, buf, PING_LEN);
+    sys_recv(pid, NULL, buf, PING_LEN);
+    int self = *(int*)buf;
+
+    if (pin(pid, 1 << core) < 0 || pin(self, 1 << core) < 0) {
+        INFO("ipcbench: cannot pin %d and %d to core %d", pid, self, core);
+        pin(pid, CORES_ALL);
+        return -1;
+    }
+
+    /* Let both processes move to core and warm up the TLB. */
+    for (uint i = 0; i < WARMUP; i++) {
+        sys_send(pid, buf, PING_LEN);
+        sys_recv(pid, NULL, buf, PING_LEN);
+    }
+
+    ulonglong start = sys_mtime();
+    for (uint i = 0; i < niters; i++) {
+        sys_send(pid, buf, PING_LEN);
+        sys_recv(pid, NULL, buf, PING_LEN);
+    }
+    ulonglong total = sys_mtime() - start;
+
+    pin(pid, CORES_ALL);
+    pin(self, CORES_ALL);
+    printf("ipcbench: %d switches on core %d in %d ticks, %d ticks per switch\r\n",
+           2 * niters, core, (uint)total, (uint)(total / (2 * niters)));
+    return 0;
+}
+
+#define MAX_PAIRS 8
+
+static int tput(uint npairs) {
+    int pids[MAX_PAIRS];
+    char buf[PING_LEN] = "go";
+
+    for (uint i = 0; i < npairs; i++)
+        sys_recv(GPID_ALL, &pids[i], buf, PING_LEN);
+
+    ulonglong start = sys_mtime();
+    for (uint i = 0; i < npairs; i++)
+        sys_send(pids[i], buf, PING_LEN);
+
+    ulonglong ntrips = 0;
+    for (uint i = 0; i < npairs; i++) {
+        uint niters;
+        sys_recv(pids[i], NULL, (void*)&niters, sizeof(niters));
+        ntrips += niters;
+    }
+    ulonglong total = sys_mtime() - start;
+
+    ulonglong ticks_per_sec = (ulonglong)MTIME_TICKS_PER_USEC * 1000000;
+    printf("ipcbench: %d pairs, %d round trips in %d ticks, "
+           "%d round trips per second\r\n", npairs, (uint)ntrips,
+           (uint)total, (uint)(ntrips * ticks_per_sec / total));
+    return 0;
+}
+
+static int usage() {
+    INFO("usage: ipcbench [N], ipcbench park &, ipcbench pong &, "
+         "ipcbench ping PID [N [COORD]], ipcbench tput K & "
+         "or ipcbench switch PID CORE [N]");
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "park") == 0) {
+        /* Nobody ever sends as GPID_UNUSED, so this never returns. */
+        sys_recv(GPID_UNUSED, NULL, NULL, 0);
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "pong") == 0) {
+        pong();
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "ping") == 0) {
+        int pid = atoi(argv[2]);
+        uint niters = (argc >= 4) ? atoi(argv[3]) : 1000;
+        int coord = (argc == 5) ? atoi(argv[4]) : 0;
+        if (pid < GPID_USER_START || niters == 0 ||
+            (argc == 5 && coord < GPID_USER_START))
+            return usage();
+        return ping(pid, niters, coord);
+    }
+
+    if (argc >= 4 && strcmp(argv[1], "switch") == 0) {
+        int pid = atoi(argv[2]);
+        uint core = atoi(argv[3]);
+        uint niters = (argc == 5) ? atoi(argv[4]) : 1000;
+        if (pid < GPID_USER_START || core > NCORES || niters == 0)
+            return usage();
+        return ctx_switch(pid, core, niters);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "tput") == 0) {
+        uint npairs = atoi(argv[2]);
+        return (npairs && npairs <= MAX_PAIRS) ? tput(npairs) : usage();
+    }
+
+    uint niters = (argc == 2) ? atoi(argv[1]) : 1000;
+    if (niters == 0) return usage();
+
+    struct term_request req;
+    req.type = TERM_OUTPUT;
+    req.len  = 0;
+
+    /* Send only the header of req, like term_write() of an empty string. */
+    uint size = sizeof(req) - TERM_BUF_SIZE;
+    ulonglong start = sys_mtime();
+    for (uint i = 0; i < niters; i++)
+        sys_send(GPID_TERMINAL, (void*)&req, size);
+    ulonglong total = sys_mtime() - start;
+
+    printf("ipcbench: %d sends of %d bytes in %d ticks, %d ticks per send\r\n",
+           niters, size, (uint)total, (uint)(total / niters));
+    return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: set the core affinity of a process
+ * `pin PID CORE...` lets process PID run only on the listed cores, and
+ * `pin PID` lets it run on any core again. For example, `pin 3 4` dedicates
+ * core #4 to GPID_FILE (as long as other processes are pinned elsewhere).
+ */
+
+#include "app.h"
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || atoi(argv[1]) <= GPID_UNUSED) {
+        INFO("usage: pin PID [CORE...]");
+        return -1;
+    }
+
+    struct proc_request req;
+    struct proc_reply reply;
+    req.type     = PROC_SET_AFFINITY;
+    req.pid      = atoi(argv[1]);
+    req.affinity = (argc == 2) ? CORES_ALL : 0;
+    for (uint i = 2; i < argc; i++) {
+        uint core = atoi(argv[i]);
+        if (core > NCORES) {
+            INFO("pin: invalid core %s", argv[i]);
+            return -1;
+        }
+        req.affinity |= (1 << core);
+    }
+
+    sys_call(GPID_PROCESS, (void*)&req, sizeof(req), (void*)&reply,
+             sizeof(reply));
+    if (reply.type != CMD_OK) {
+        INFO("pin: no process %d or no booted core in 0x%x", req.pid, req.affinity);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: a periodic task paced by the real-time (EDF) class
+ * `rtpace PERIOD BUDGET WORK [N]` joins the real-time class with BUDGET usec
+ * of CPU time in every PERIOD usec, and then runs N jobs (100 by default),
+ * one per period, each spinning for WORK usec like a packet transmission of
+ * udp_hello. It prints how late the jobs started and finished relative to
+ * their periods. Run it next to a few `loop &` to see the effect of the
+ * real-time class, and with BUDGET 0 to compare with the MLFQ.
+ */
+
+#include "app.h"
+#include <stdlib.h>
+
+int main(int argc, char** argv) {
+    if (argc != 4 && argc != 5) {
+        INFO("usage: rtpace PERIOD BUDGET WORK [N]");
+        return -1;
+    }
+    uint period = atoi(argv[1]), budget = atoi(argv[2]), work = atoi(argv[3]);
+    uint njobs  = (argc == 5) ? atoi(argv[4]) : 100;
+    if (period == 0 || njobs == 0) return -1;
+
+    if (budget && sys_rt_set(period, budget) < 0) {
+        INFO("rtpace: %d usec every %d usec is not admitted", budget, period);
+        return -1;
+    }
+
+    ulonglong ticks   = (ulonglong)period * MTIME_TICKS_PER_USEC;
+    ulonglong release = sys_mtime(), late_max = 0, late_total = 0;
+    uint nlate = 0;
+    for (uint i = 0; i < njobs; i++) {
+        ulonglong start = sys_mtime();
+        if (start - release > late_max) late_max = start - release;
+        late_total += start - release;
+
+        /* The job, which should be done by the end of its period. */
+        while (sys_mtime() - start < (ulonglong)work * MTIME_TICKS_PER_USEC);
+        release += ticks;
+
+        ulonglong now = sys_mtime();
+        if (now > release)
+            nlate++;
+        else
+            sys_sleep((uint)((release - now) / MTIME_TICKS_PER_USEC));
+    }
+    if (budget) sys_rt_set(0, 0);
+
+    printf("rtpace: %d jobs, start latency avg %d max %d ticks, ",
+           njobs, (uint)(late_total / njobs), (uint)late_max);
+    printf("%d jobs finished after their period\r\n", nlate);
+    return 0;
+}
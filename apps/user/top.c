@@ -0,0 +1,69 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: a top-style monitor of processes
+ * `top [N]` asks GPID_PROCESS for the CPU accounting of every process and
+ * prints it N times (10 by default), once per second. The CPU share is for
+ * the last second, so `top 1` prints the totals only like ps.
+ */
+
+#include "app.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint ticks_to_ms(ulonglong ticks) {
+    return (uint)(ticks / (MTIME_TICKS_PER_USEC * 1000));
+}
+
+/* CPU time of each process at the last refresh, indexed by pid */
+static int last_pid[MAX_NPROCESS];
+static ulonglong last_cpu[MAX_NPROCESS];
+
+int main(int argc, char** argv) {
+    uint nrounds = (argc == 2) ? atoi(argv[1]) : 10;
+    if (nrounds == 0) {
+        INFO("usage: top [N]");
+        return -1;
+    }
+
+    struct proc_request req;
+    struct proc_info_reply reply;
+    req.type = PROC_INFO;
+
+    ulonglong last_time = 0;
+    for (uint round = 0; round < nrounds; round++) {
+        if (round) sleep(1000000);
+
+        sys_call(GPID_PROCESS, (void*)&req, sizeof(req.type), (void*)&reply,
+                 sizeof(reply));
+        ulonglong now = sys_mtime();
+
+        if (nrounds > 1) printf("\e[1;1H\e[2J");
+        printf("PID\tCORE\tCORES\tLEVEL\t%s\tCPU ms\tBLOCKED ms\tSWITCHES\tSYSCALLS\r\n",
+               "CPU%");
+        for (uint i = 0; i < reply.nprocs; i++) {
+            struct proc_info* p = &reply.procs[i];
+            uint slot = p->pid % MAX_NPROCESS;
+
+            printf("%d\t%d\t", p->pid, p->core);
+            if (p->affinity == CORES_ALL)
+                printf("all\t");
+            else
+                printf("0x%x\t", p->affinity);
+            printf("%d\t", p->level);
+            if (last_time && last_pid[slot] == p->pid)
+                printf("%d\t", (uint)((p->cpu_time - last_cpu[slot]) * 100 /
+                                      (now - last_time)));
+            else
+                printf("-\t");
+            printf("%d\t%d\t\t%d\t\t%d\r\n", ticks_to_ms(p->cpu_time),
+                   ticks_to_ms(p->blocked_time), p->nswitch, p->nsyscall);
+
+            last_pid[slot] = p->pid;
+            last_cpu[slot] = p->cpu_time;
+        }
+        last_time = now;
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@
 void tty_init();
 void disk_init();
 void mmu_init();
+void pmp_init();
 void intr_init(uint core_id);
 
 struct grass* grass = (void*)GRASS_STRUCT_BASE;
@@ -49,14 +50,12 @@ void boot() {
     } else {
         SUCCESS("--- Core #%d starts running ---", core_id);
 
-        /* Student's code goes here (Multicore & Locks). */
-
-        /* Initialize the MMU and interrupts on this CPU core.
-         * Read mmu_init() and intr_init(), and decide what to do here. */
-
-        /* Call function core_set_idle, reset the timer, release the boot
-         * lock, and wait for a timer interrupt using the wfi instruction. */
+        /* The PMP and interrupt CSRs are per-core. Page tables are switched
+         * on by the scheduler (mmu_switch) when this core runs a process. */
+        pmp_init();
+        intr_init(core_id);
 
-        /* Student's code ends here. */
+        /* Enter the idle loop of this core, which releases the boot lock. */
+        core_set_idle(core_id);
     }
 }
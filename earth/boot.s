@@ -10,8 +10,10 @@
 boot_loader:
     la t0, boot_lock          /* Load the address of boot_lock. */
     li t1, 1
-    amoswap.w.aq t1, t1, (t0) /* Acquire boot_lock. */
-    bnez t1, boot_loader
+    amoadd.w t1, t1, (t0)     /* Take a ticket of boot_lock (next++). */
+1:  lw t2, 4(t0)
+    bne t1, t2, 1b            /* Wait until boot_lock.owner is our ticket. */
+    fence r, rw               /* Acquire boot_lock. */
     li sp, 0x80400000 /* Set SP to the BOOT stack */
     call boot
 
@@ -19,5 +21,6 @@ hang:
     call hang
 
 .bss
-    boot_lock:       .word 0
+    .balign 8
+    boot_lock:       .zero 40 /* struct spinlock, see library/libc/spinlock.h */
     booted_core_cnt: .word 0
@@ -4,13 +4,15 @@
  *
  * Description: wrapping the CPU interface for interrupts
  * Initialize the trap entry, enable interrupts, and reset the timer.
+ * The software interrupt of a core (msip in CLINT) is used by other cores
+ * as an inter-processor interrupt (IPI).
  */
 
 #include "egos.h"
 
 #define MTIME_BASE    (CLINT_BASE + 0xBFF8)
 #define MTIMECMP_BASE (CLINT_BASE + 0x4000)
-#define QUANTUM       (earth->platform == QEMU ? 100000UL : 50000000UL)
+#define MSIP_BASE     (CLINT_BASE + 0x0)
 
 ulonglong mtime_get() {
     uint low, high;
@@ -28,22 +30,30 @@ static void mtimecmp_set(ulonglong time, uint core_id) {
     REGW(MTIMECMP_BASE, core_id * 8 + 4) = (uint)(time >> 32);
 }
 
-static void timer_reset(uint core_id) {
-    mtimecmp_set(mtime_get() + 10*QUANTUM, core_id);
+static void timer_reset(uint core_id, uint nquantum) {
+    mtimecmp_set(mtime_get() + nquantum * QUANTUM, core_id);
 }
 
-void trap_entry(); /* See grass/kernel.s */
+static void ipi_send(uint core_id) { REGW(MSIP_BASE, core_id * 4) = 1; }
+
+static void ipi_clear(uint core_id) { REGW(MSIP_BASE, core_id * 4) = 0; }
+
+void trap_entry(); /* See grass/kernel.S */
 void intr_init(uint core_id) {
     /* Initialize the timer. */
     earth->timer_reset = timer_reset;
-    timer_reset(core_id);
+    earth->timer_set   = mtimecmp_set;
+    timer_reset(core_id, 10);
+    earth->ipi_send  = ipi_send;
+    earth->ipi_clear = ipi_clear;
+    ipi_clear(core_id);
 
     /* Setup the interrupt/exception handling entry. */
     asm("csrw mtvec, %0" ::"r"(trap_entry));
     INFO("Use direct mode and put the address of the trap_entry into mtvec");
 
-    /* Enable timer interrupt. */
+    /* Enable timer and software interrupts. */
     asm("csrw mip, %0" ::"r"(0));
-    asm("csrs mie, %0" ::"r"(0x80));
+    asm("csrs mie, %0" ::"r"(0x88));
     asm("csrs mstatus, %0" ::"r"(0x88));
 }
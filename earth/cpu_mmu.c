@@ -10,54 +10,170 @@
 #include "egos.h"
 #include <string.h>
 
-#define PAGE_SIZE          4096
 #define PAGE_NO_TO_ADDR(x) (char*)(x * PAGE_SIZE)
 #define PAGE_ID_TO_ADDR(x) ((char*)APPS_PAGES_BASE + x * PAGE_SIZE)
 #define APPS_PAGES_CNT     (RAM_END - APPS_PAGES_BASE) / PAGE_SIZE
 
+/* A physical page is free, allocated, or owned by a pid once mapped (or
+ * used as a page table of the pid). Free pages are linked on free_pages and
+ * the pages of a pid on pid_to_pages, through `prev` and `next` (indices
+ * into page_info_table, NO_PAGE at the ends). So mmu_alloc is O(1), and
+ * mmu_free and soft_tlb_switch only visit the pages of a pid. */
+#define NO_PAGE -1
 struct page_info {
-    int use;
+    enum { PAGE_FREE, PAGE_ALLOCATED, PAGE_OWNED } use;
     int pid;
     uint vpage_no;
+    int prev, next;
 } page_info_table[APPS_PAGES_CNT];
+static int free_pages;
+
+/* At most MAX_NPROCESS processes are alive at the same time and the grass
+ * layer never gives two alive processes the same pid % MAX_NPROCESS. */
+static uint* pid_to_pagetable_base[MAX_NPROCESS];
+static int pid_to_pages[MAX_NPROCESS];
+
+#define for_each_page(i, pid) \
+    for (int i = pid_to_pages[(pid) % MAX_NPROCESS]; i != NO_PAGE; i = page_info_table[i].next)
+
+static void page_push(int* list, int i) {
+    page_info_table[i].prev = NO_PAGE;
+    page_info_table[i].next = *list;
+    if (*list != NO_PAGE) page_info_table[*list].prev = i;
+    *list = i;
+}
+
+static void page_remove(int* list, int i) {
+    struct page_info* page = &page_info_table[i];
+    if (page->prev != NO_PAGE)
+        page_info_table[page->prev].next = page->next;
+    else
+        *list = page->next;
+    if (page->next != NO_PAGE) page_info_table[page->next].prev = page->prev;
+}
+
+/* put page i on the list of pid, taking it off the list of its old owner */
+static void page_own(uint i, int pid) {
+    struct page_info* page = &page_info_table[i];
+    if (page->use == PAGE_OWNED && page->pid == pid) return;
+    if (page->use == PAGE_OWNED)
+        page_remove(&pid_to_pages[page->pid % MAX_NPROCESS], i);
+
+    page->use = PAGE_OWNED;
+    page->pid = pid;
+    page_push(&pid_to_pages[pid % MAX_NPROCESS], i);
+}
+
+static void soft_tlb_init();
+static void soft_tlb_unload(uint ppage_id, int write_back);
+static void asid_changed(int pid);
+
+static void page_init() {
+    soft_tlb_init();
+    free_pages = NO_PAGE;
+    for (int i = APPS_PAGES_CNT - 1; i >= 0; i--) page_push(&free_pages, i);
+    for (uint i = 0; i < MAX_NPROCESS; i++) pid_to_pages[i] = NO_PAGE;
+}
+
+/* The cores (and sys_proc calling grass functions) share page_info_table
+ * and the page tables, so the functions in the earth interface take
+ * mmu_lock, and call the unlocked versions below (named with __) inside. */
+static struct spinlock mmu_lock;
+
+static uint __mmu_alloc() {
+    int i = free_pages;
+    if (i == NO_PAGE) FATAL("mmu_alloc: no more free memory");
+
+    page_remove(&free_pages, i);
+    page_info_table[i].use = PAGE_ALLOCATED;
+    return i;
+}
 
 uint mmu_alloc() {
-    for (uint i = 0; i < APPS_PAGES_CNT; i++)
-        if (!page_info_table[i].use) {
-            page_info_table[i].use = 1;
-            return i;
-        }
-    FATAL("mmu_alloc: no more free memory");
+    acquire(mmu_lock);
+    uint ppage_id = __mmu_alloc();
+    release(mmu_lock);
+    return ppage_id;
 }
 
 void mmu_free(int pid) {
-    for (uint i = 0; i < APPS_PAGES_CNT; i++)
-        if (page_info_table[i].use && page_info_table[i].pid == pid)
-            memset(&page_info_table[i], 0, sizeof(struct page_info));
+    /* This also frees the page tables of pid (if any). */
+    acquire(mmu_lock);
+    int* pages = &pid_to_pages[pid % MAX_NPROCESS];
+    while (*pages != NO_PAGE) {
+        int i = *pages;
+        page_remove(pages, i);
+        soft_tlb_unload(i, 0);
+        memset(&page_info_table[i], 0, sizeof(struct page_info));
+        page_push(&free_pages, i);
+    }
+    pid_to_pagetable_base[pid % MAX_NPROCESS] = NULL;
+    asid_changed(pid);
+    release(mmu_lock);
 }
 
-void soft_tlb_map(int pid, uint vpage_no, uint ppage_id) {
-    page_info_table[ppage_id].pid      = pid;
+static void soft_tlb_map(int pid, uint vpage_no, uint ppage_id) {
+    page_own(ppage_id, pid);
     page_info_table[ppage_id].vpage_no = vpage_no;
 }
 
-void soft_tlb_switch(int pid) {
-    static int curr_vm_pid = -1;
-    if (pid == curr_vm_pid) return;
+/* The software TLB copies the pages of a process to their virtual addresses
+ * (in [APPS_ENTRY, APPS_STACK_TOP)) lazily: a page stays there after a switch
+ * until another process needs the same virtual page, and it is copied back
+ * only if it differs from its physical page, which is not written while the
+ * page is resident. So a switch only copies the pages that conflict with
+ * those of other processes. */
+#define SOFT_TLB_BASE   (APPS_ENTRY / PAGE_SIZE)
+#define SOFT_TLB_NPAGES ((APPS_STACK_TOP - APPS_ENTRY) / PAGE_SIZE)
+static int resident[SOFT_TLB_NPAGES]; /* ppage_id at each vpage, or NO_PAGE */
+static int curr_vm_pid = -1;
+
+static void soft_tlb_init() {
+    for (uint i = 0; i < SOFT_TLB_NPAGES; i++) resident[i] = NO_PAGE;
+}
 
-    /* Unmap curr_vm_pid from the user address space. */
-    for (uint i = 0; i < APPS_PAGES_CNT; i++)
-        if (page_info_table[i].use && page_info_table[i].pid == curr_vm_pid)
-            memcpy(PAGE_ID_TO_ADDR(i),
-                   PAGE_NO_TO_ADDR(page_info_table[i].vpage_no), PAGE_SIZE);
+static int* soft_tlb_slot(uint vpage_no) {
+    if (vpage_no < SOFT_TLB_BASE || vpage_no >= SOFT_TLB_BASE + SOFT_TLB_NPAGES)
+        return NULL;
+    return &resident[vpage_no - SOFT_TLB_BASE];
+}
+
+/* copy ppage_id to its vpage_no, moving away the page resident there */
+static void soft_tlb_load(uint ppage_id) {
+    struct page_info* page = &page_info_table[ppage_id];
+    int* slot              = soft_tlb_slot(page->vpage_no);
+    if (slot == NULL)
+        FATAL("soft_tlb_load: vpage 0x%x is out of the app region", page->vpage_no);
+    if (*slot == ppage_id) return;
+    if (*slot != NO_PAGE) soft_tlb_unload(*slot, 1);
+
+    memcpy(PAGE_NO_TO_ADDR(page->vpage_no), PAGE_ID_TO_ADDR(ppage_id), PAGE_SIZE);
+    *slot = ppage_id;
+}
+
+/* if ppage_id is resident, copy it back if written (and write_back is set) */
+static void soft_tlb_unload(uint ppage_id, int write_back) {
+    struct page_info* page = &page_info_table[ppage_id];
+    int* slot              = soft_tlb_slot(page->vpage_no);
+    if (slot == NULL || *slot != ppage_id) return;
+
+    char* vaddr = PAGE_NO_TO_ADDR(page->vpage_no);
+    char* paddr = PAGE_ID_TO_ADDR(ppage_id);
+    if (write_back && memcmp(paddr, vaddr, PAGE_SIZE) != 0)
+        memcpy(paddr, vaddr, PAGE_SIZE);
+    *slot = NO_PAGE;
+}
 
-    /* Map pid to the user address space. */
-    for (uint i = 0; i < APPS_PAGES_CNT; i++)
-        if (page_info_table[i].use && page_info_table[i].pid == pid)
-            memcpy(PAGE_NO_TO_ADDR(page_info_table[i].vpage_no),
-                   PAGE_ID_TO_ADDR(i), PAGE_SIZE);
+void flush_cache();
 
+void soft_tlb_switch(int pid) {
+    if (pid == curr_vm_pid) return;
+
+    /* Map pid to the user address space, and the pages of other processes
+     * stay where pid does not need their virtual pages. */
+    for_each_page(i, pid) soft_tlb_load(i);
     curr_vm_pid = pid;
+    flush_cache();
 }
 
 uint soft_tlb_translate(int pid, uint vaddr) {
@@ -67,11 +183,8 @@ uint soft_tlb_translate(int pid, uint vaddr) {
 
 /* The code below creates an identity map using page tables (RISC-V Sv32). */
 #define USER_RWX     (0xC0 | 0x1F)
-#define MAX_NPROCESS 256
 static uint* root;
 static uint* leaf;
-static uint* pid_to_pagetable_base[MAX_NPROCESS];
-/* Assume at most MAX_NPROCESS unique processes just for simplicity. */
 
 void setup_identity_region(int pid, uint addr, uint npages, uint flag) {
     uint vpn1 = addr >> 22;
@@ -81,9 +194,9 @@ void setup_identity_region(int pid, uint addr, uint npages, uint flag) {
         leaf = (void*)((root[vpn1] << 2) & 0xFFFFF000);
     } else {
         /* Allocate the leaf page table. */
-        uint ppage_id                 = earth->mmu_alloc();
-        leaf                          = (void*)PAGE_ID_TO_ADDR(ppage_id);
-        page_info_table[ppage_id].pid = pid;
+        uint ppage_id = __mmu_alloc();
+        leaf          = (void*)PAGE_ID_TO_ADDR(ppage_id);
+        page_own(ppage_id, pid);
         memset(leaf, 0, PAGE_SIZE);
         root[vpn1] = ((uint)leaf >> 2) | 0x1;
     }
@@ -96,10 +209,10 @@ void setup_identity_region(int pid, uint addr, uint npages, uint flag) {
 
 void pagetable_identity_map(int pid) {
     /* Allocate the root page table. */
-    uint ppage_id                 = earth->mmu_alloc();
-    root                          = (void*)PAGE_ID_TO_ADDR(ppage_id);
-    page_info_table[ppage_id].pid = pid;
-    pid_to_pagetable_base[pid]    = root;
+    uint ppage_id                             = __mmu_alloc();
+    root                                      = (void*)PAGE_ID_TO_ADDR(ppage_id);
+    pid_to_pagetable_base[pid % MAX_NPROCESS] = root;
+    page_own(ppage_id, pid);
     memset(root, 0, PAGE_SIZE);
 
     /* Setup the identity map for various memory regions. */
@@ -117,57 +230,140 @@ void pagetable_identity_map(int pid) {
     }
 }
 
-void page_table_map(int pid, uint vpage_no, uint ppage_id) {
-    if (pid >= MAX_NPROCESS) FATAL("page_table_map: pid too large");
-
-    /* Student's code goes here (Virtual Memory). */
-
-    /* Remove the soft_tlb_map below and do the following.
-     * (1) If page tables for pid do not exist, build the tables.
-     *   Case#1: pid < GPID_USER_START
-     * | Start Address | # Pages | Size   | Explanation                        |
-     * +---------------+---------+--------+------------------------------------+
-     * | 0x80000000    | 1024    | 4 MB   | EGOS region (code+data+heap+stack) |
-     * | 0x80400000    | 1024    | 4 MB   | Apps region (code+data+heap+stack) |
-     * | 0x80800000    | 2048    | 8 MB   | Memroy pages for allocation        |
-     * | CLINT_BASE    | 16      | 64 KB  | Memory-mapped registers for timer  |
-     * | UART_BASE     | 1       | 4 KB   | Memory-mapped registers for TTY    |
-     * | SPI_BASE      | 1       | 4 KB   | Memory-mapped registers for SD     |
-     *
-     *   Case#2: pid >= GPID_USER_START
-     * | Start Address | # Pages | Size   | Explanation                        |
-     * +---------------+---------+--------+------------------------------------+
-     * | 0x80602000    | 1       | 4 KB   | Work dir (see apps/app.h)          |
-     *
-     * (2) After building page tables for pid (or if page tables for pid exist),
-     *     update the page tables and map vpage_no to ppage_id based on Sv32. */
+/* Sv32 tags the TLB entries with the ASID in satp, so a switch does not need
+ * to flush the TLB. The ASID of pid is pid % MAX_NPROCESS, the same slot as
+ * its page table. The TLB of a core may still hold the entries of an ASID
+ * when its page table changes (or another pid gets its slot), so changes
+ * bump asid_gen[slot], and a core flushes the ASID (and, on Arty, its
+ * instruction cache) when it switches to a slot whose asid_gen it has not
+ * seen. mmu_map and mmu_free may run in user mode (in sys_proc), so they
+ * only bump asid_gen, and the flushes happen in page_table_switch. */
+#define SATP_ASID(x) ((x) << 22)
+static int asid_on;
+static uint asid_gen[MAX_NPROCESS];
+static uint asid_seen[NCORES + 1][MAX_NPROCESS]; /* by mhartid, like cores[] */
+
+static void asid_changed(int pid) {
+    __atomic_add_fetch(&asid_gen[pid % MAX_NPROCESS], 1, __ATOMIC_RELEASE);
+}
+
+static uint asid_core() {
+    uint core_id;
+    asm("csrr %0, mhartid" : "=r"(core_id));
+    return core_id;
+}
+
+/* flush the TLB entries of asid at vaddr (or all of them if vaddr is 0) */
+static void asid_flush(uint asid, uint vaddr) {
+    if (vaddr)
+        asm("sfence.vma %0, %1" ::"r"(vaddr), "r"(asid));
+    else
+        asm("sfence.vma zero, %0" ::"r"(asid));
+}
+
+static void page_table_map(int pid, uint vpage_no, uint ppage_id) {
+    /* Build the identity map above at the first mapping of pid. For
+     * simplicity, user processes get the same identity map as the system
+     * processes, with their own pages mapped on top of it. */
+    if (pid_to_pagetable_base[pid % MAX_NPROCESS] == NULL)
+        pagetable_identity_map(pid);
+
+    /* Record pid and vpage_no of ppage_id in page_info_table. */
     soft_tlb_map(pid, vpage_no, ppage_id);
 
-    /* Student's code ends here. */
+    /* Map vpage_no to ppage_id in the leaf page table. */
+    uint* pt_root = pid_to_pagetable_base[pid % MAX_NPROCESS];
+    uint vpn1 = vpage_no >> 10, vpn0 = vpage_no & 0x3FF;
+    if (!(pt_root[vpn1] & 0x1))
+        FATAL("page_table_map: vpage 0x%x is not in the identity map", vpage_no);
+
+    uint* pt_leaf = (void*)((pt_root[vpn1] << 2) & 0xFFFFF000);
+    pt_leaf[vpn0] = ((uint)PAGE_ID_TO_ADDR(ppage_id) >> 2) | USER_RWX;
+    asid_changed(pid);
 }
 
 void page_table_switch(int pid) {
-    /* Student's code goes here (Virtual Memory). */
-
-    /* Remove the soft_tlb_switch below and, instead, update the page table
-     * base register (satp) using the value of pid_to_pagetable_base[pid].
-     * An example of updating the satp CSR is given in function mmu_init. */
-    soft_tlb_switch(pid);
+    uint slot     = pid % MAX_NPROCESS;
+    uint* pt_root = pid_to_pagetable_base[slot];
+    uint satp     = ((uint)pt_root >> 12) | (1 << 31);
+    if (!asid_on) {
+        asm("csrw satp, %0" ::"r"(satp));
+        flush_cache();
+        return;
+    }
 
-    /* Student's code ends here. */
+    asm("csrw satp, %0" ::"r"(satp | SATP_ASID(slot)));
+    uint core_id = asid_core();
+    uint gen     = __atomic_load_n(&asid_gen[slot], __ATOMIC_ACQUIRE);
+    if (asid_seen[core_id][slot] != gen) {
+        asid_flush(slot, 0);
+        if (earth->platform == ARTY) flush_cache();
+        asid_seen[core_id][slot] = gen;
+    }
 }
 
 uint page_table_translate(int pid, uint vaddr) {
-    /* Student's code goes here (Virtual Memory). */
+    uint* pt_root = pid_to_pagetable_base[pid % MAX_NPROCESS];
+    uint* pt_leaf = (void*)((pt_root[vaddr >> 22] << 2) & 0xFFFFF000);
+    uint pte      = pt_leaf[(vaddr >> 12) & 0x3FF];
+    return ((pte << 2) & 0xFFFFF000) | (vaddr & 0xFFF);
+}
 
-    /* Remove the following line of code. Walk through the page tables
-     * for process pid and return the physical address mapped from vaddr. */
-    return soft_tlb_translate(pid, vaddr);
+static uint page_lookup(int pid, uint vpage_no) {
+    for_each_page(i, pid)
+        if (page_info_table[i].vpage_no == vpage_no) return i;
+    FATAL("page_lookup: vpage 0x%x of pid %d is not mapped", vpage_no, pid);
+}
 
-    /* Student's code ends here. */
+/* page_table_map() or soft_tlb_map(), called with mmu_lock held */
+static void (*__mmu_map)(int pid, uint vpage_no, uint ppage_id);
+
+void mmu_map(int pid, uint vpage_no, uint ppage_id) {
+    acquire(mmu_lock);
+    __mmu_map(pid, vpage_no, ppage_id);
+    release(mmu_lock);
+}
+
+void mmu_swap(int pid1, int pid2, uint vpage_no) {
+    /* Exchange the physical pages of pid1 and pid2 at vpage_no. */
+    acquire(mmu_lock);
+    uint page1 = page_lookup(pid1, vpage_no);
+    uint page2 = page_lookup(pid2, vpage_no);
+
+    /* The software TLB may hold page1 or page2 at vpage_no, so write it
+     * back before the exchange, and load the new page of curr_vm_pid (if it
+     * is pid1 or pid2) after it. */
+    int soft_tlb = (earth->translation == SOFT_TLB);
+    if (soft_tlb) {
+        soft_tlb_unload(page1, 1);
+        soft_tlb_unload(page2, 1);
+    }
+
+    __mmu_map(pid1, vpage_no, page2);
+    __mmu_map(pid2, vpage_no, page1);
+
+    if (soft_tlb && (curr_vm_pid == pid1 || curr_vm_pid == pid2))
+        soft_tlb_load((curr_vm_pid == pid1) ? page2 : page1);
+
+    /* mmu_swap runs in the kernel (for sys_recv), so it flushes vpage_no of
+     * both ASIDs on this core right away, and other cores flush the ASIDs
+     * when they switch to pid1 or pid2 next time. */
+    if (!soft_tlb && asid_on) {
+        uint core_id = asid_core();
+        int pids[2]  = {pid1, pid2};
+        for (uint i = 0; i < 2; i++) {
+            uint slot      = pids[i] % MAX_NPROCESS;
+            int up_to_date = (asid_seen[core_id][slot] == asid_gen[slot] - 1);
+            asid_flush(slot, vpage_no * PAGE_SIZE);
+            if (up_to_date) asid_seen[core_id][slot] = asid_gen[slot];
+        }
+    }
+    release(mmu_lock);
+    if (soft_tlb || !asid_on) flush_cache();
 }
 
 void flush_cache() {
+    /* With ASIDs, page_table_switch and mmu_swap flush only what changed. */
     if (earth->platform == ARTY) {
         /* Flush the L1 instruction cache. */
         /* See
@@ -184,11 +380,7 @@ void flush_cache() {
     }
 }
 
-void mmu_init() {
-    earth->mmu_free        = mmu_free;
-    earth->mmu_alloc       = mmu_alloc;
-    earth->mmu_flush_cache = flush_cache;
-
+void pmp_init() {
     /* Setup a PMP region for the whole 4GB address space. */
     asm("csrw pmpaddr0, %0" : : "r"(0x40000000));
     asm("csrw pmpcfg0, %0" : : "r"(0xF));
@@ -199,26 +391,50 @@ void mmu_init() {
      * and set the permission for user mode access as r/w/x. */
 
     /* Student's code ends here. */
+}
+
+void mmu_init() {
+    earth->mmu_free        = mmu_free;
+    earth->mmu_alloc       = mmu_alloc;
+    earth->mmu_map         = mmu_map;
+    earth->mmu_swap        = mmu_swap;
+    earth->mmu_flush_cache = flush_cache;
+
+    pmp_init();
+    page_init();
 
     CRITICAL("Choose a memory translation mechanism:");
     printf("Enter 0: page tables\r\nEnter 1: software TLB\r\n");
+    printf("Enter 2: page tables without ASIDs\r\n");
 
     char buf[2];
-    for (buf[0] = 0; buf[0] != '0' && buf[0] != '1'; earth->tty_read(&buf[0]));
-    earth->translation = (buf[0] == '0') ? PAGE_TABLE : SOFT_TLB;
+    for (buf[0] = 0; buf[0] < '0' || buf[0] > '2'; earth->tty_read(&buf[0]));
+    earth->translation = (buf[0] == '1') ? SOFT_TLB : PAGE_TABLE;
     INFO("%s translation is chosen",
          earth->translation == PAGE_TABLE ? "Page table" : "Software");
 
     if (earth->translation == PAGE_TABLE) {
         /* Setup an identity map using page tables. */
         pagetable_identity_map(0);
-        asm("csrw satp, %0" ::"r"(((uint)root >> 12) | (1 << 31)));
+        uint satp = ((uint)root >> 12) | (1 << 31);
+
+        /* The CPU implements the ASID bits which keep the ones written. */
+        uint asid_bits;
+        asm("csrw satp, %0" ::"r"(satp | SATP_ASID(0x1FF)));
+        asm("csrr %0, satp" : "=r"(asid_bits));
+        asm("csrw satp, %0" ::"r"(satp));
+        asm("sfence.vma zero,zero");
+
+        asid_bits = (asid_bits >> 22) & 0x1FF;
+        asid_on   = (buf[0] == '0' && asid_bits >= MAX_NPROCESS - 1);
+        INFO("ASIDs are %s (the CPU keeps ASID bits 0x%x)",
+             asid_on ? "used" : "not used", asid_bits);
 
-        earth->mmu_map       = page_table_map;
+        __mmu_map            = page_table_map;
         earth->mmu_switch    = page_table_switch;
         earth->mmu_translate = page_table_translate;
     } else {
-        earth->mmu_map       = soft_tlb_map;
+        __mmu_map            = soft_tlb_map;
         earth->mmu_switch    = soft_tlb_switch;
         earth->mmu_translate = soft_tlb_translate;
     }
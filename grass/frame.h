@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: stack frames of the kernel, shared by kernel.S and C code
+ * A trap frame holds every register of the interrupted code; trap_entry
+ * pushes it on the kernel stack of a process and pops it before mret.
+ * A context frame holds only what the C calling convention requires a
+ * callee to preserve, since ctx_switch and ctx_start are called from C and
+ * the caller-saved registers of the process are already in its trap frame.
+ */
+
+/* trap frame (byte offsets) */
+#define TF_A0   0   // a0-a7 at TF_A0 + 4 * i
+#define TF_T0   32  // t0-t6 at TF_T0 + 4 * i
+#define TF_S0   60  // s0-s11 at TF_S0 + 4 * i
+#define TF_RA   108
+#define TF_GP   112
+#define TF_TP   116
+#define TF_SP   120 // sp of the interrupted code
+#define TRAP_FRAME_SIZE 128
+
+/* context frame of ctx_switch and ctx_start (byte offsets) */
+#define CTX_RA  0
+#define CTX_S0  4   // s0-s11 at CTX_S0 + 4 * i
+#define CTX_FRAME_SIZE 64 // keeps sp 16-byte aligned
+
+#ifndef __ASSEMBLER__
+struct trap_frame {
+    uint a[8], t[7], s[12];
+    uint ra, gp, tp, sp;
+    uint unused;
+};
+
+struct ctx_frame {
+    uint ra, s[12];
+    uint unused[3];
+};
+#endif
@@ -7,9 +7,8 @@
  */
 
 #include "process.h"
+#include "trace.h"
 #include "elf.h"
-#include "queue.h"
-#include "list.h"
 
 /*
 #include <stdlib.h>
@@ -53,53 +52,63 @@ void malloc_stresstest() {
 }
 */
 
-extern list_t proc_set;
-extern queue_t runQ, readyQ;
-extern struct process *proc_curr;
 
 static void sys_proc_read(uint block_no, char* dst) {
     earth->disk_read(SYS_PROC_EXEC_START + block_no, 1, dst);
 }
 
+static void core_set_mode() {
+    /* Processes run in the mode set here after mret. */
+    uint mstatus, M_MODE = 3, U_MODE = 0;
+    uint GRASS_MODE = (earth->translation == SOFT_TLB) ? M_MODE : U_MODE;
+    asm("csrr %0, mstatus" : "=r"(mstatus));
+    mstatus = (mstatus & ~(3 << 11)) | (GRASS_MODE << 11);
+    asm("csrw mstatus, %0" ::"r"(mstatus));
+}
+
 void grass_entry() {
     SUCCESS("Enter the grass layer");
 
     /* Initialize the grass interface. */
     grass->proc_free      = proc_free;
+    grass->proc_info      = proc_info;
     grass->proc_alloc     = proc_alloc;
     grass->proc_set_ready = proc_set_ready;
+    grass->proc_set_affinity = proc_set_affinity;
     grass->sys_send       = sys_send;
     grass->sys_recv       = sys_recv;
-    /* Student's code goes here (System Call | Multicore & Locks). */
-
-    /* Initialize the grass interface for proc_sleep() or proc_coresinfo(). */
-
-    /* Student's code ends here. */
+    grass->sys_send_bulk  = sys_send_bulk;
+    grass->sys_call       = sys_call;
+    grass->sys_reply_wait = sys_reply_wait;
+    grass->sys_reply_bulk_wait = sys_reply_bulk_wait;
+    grass->sched_info     = proc_sched_info;
+    grass->sys_sleep      = sys_sleep;
+    grass->proc_coresinfo = proc_coresinfo;
+    grass->trace_dump     = trace_dump;
+    grass->lock_info      = proc_lock_info;
+
+    /* Record disk accesses in the kernel trace. */
+    trace_init();
+
+    /* Measure the contention on kernel locks (see the lockinfo command). */
+    proc_lock_init();
 
     /* Load GPID_PROCESS. */
     INFO("Load kernel process #%d: sys_process", GPID_PROCESS);
     elf_load(GPID_PROCESS, sys_proc_read, 0, 0);
 
-    /* create kernel data structures */
-    if ((proc_set = list_new()) == EGOSNULL)
-        FATAL("grass_entry: failed to create proc_set");
-    if ((runQ = queue_new()) == EGOSNULL)
-        FATAL("grass_entry: failed to create runQ");
-    if ((readyQ = queue_new()) == EGOSNULL)
-        FATAL("grass_entry: failed to create readyQ");
+    core_idle_init(core_id(), proc_idle);
 
     proc_curr = proc_alloc();
+    proc_curr->status = PROC_STARTED;
+    proc_curr->on_cpu = 1;
 
     if (proc_curr->pid != GPID_PROCESS)
         FATAL("grass_entry: first alloc'd process has pid %d instead of 1", proc_curr->pid);
     earth->mmu_switch(GPID_PROCESS);
     earth->mmu_flush_cache();
-
-    uint mstatus, M_MODE = 3, U_MODE = 0;
-    uint GRASS_MODE = (earth->translation == SOFT_TLB) ? M_MODE : U_MODE;
-    asm("csrr %0, mstatus" : "=r"(mstatus));
-    mstatus = (mstatus & ~(3 << 11)) | (GRASS_MODE << 11);
-    asm("csrw mstatus, %0" ::"r"(mstatus));
+    proc_curr->dispatch_time = mtime_get();
+    core_set_mode();
 
     asm("csrw mepc, %0" ::"r"(APPS_ENTRY));
     asm("csrw mscratch, %0"::"r"(proc_curr->ksp)); // for kernel stack switch on trap entry
@@ -109,3 +118,20 @@ void grass_entry() {
     /* If using page table translation, the CPU will enter the user mode after
      * this mret and thus page table translation will start to take effect. */
 }
+
+static void core_boot_done() {
+    /* Running on the idle stack now, so the next core can use the boot stack. */
+    release(boot_lock);
+    proc_idle();
+}
+
+void core_set_idle(uint core) {
+    /* Called by every core other than the first booted one; never returns. */
+    asm("csrc mstatus, %0" ::"r"(0x8)); /* proc_idle() runs without interrupts */
+    core_set_mode();
+
+    void* boot_sp;
+    core_idle_init(core, core_boot_done);
+    cores[core].next = &cores[core].idle;
+    ctx_switch(&boot_sp, &cores[core].next->ksp);
+}
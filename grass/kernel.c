@@ -7,23 +7,50 @@
  *   excp_entry() handles system calls and faults (e.g., invalid memory access).
  */
 
-void ctx_switch(void **old_sp, void **new_sp);
-void ctx_start(void **old_sp, void *new_sp);
-
 #include "process.h"
-#include "queue.h"
-#include "list.h"
+#include "trace.h"
 #include <string.h>
 
-uint core_in_kernel;
+struct spinlock ready_lock;
+struct procq readyQ = {.lock = &ready_lock}; // can be scheduled (for the first time)
+struct core cores[NCORES + 1];
+
+// time slice of each MLFQ level (in QUANTUM), which is also the time a
+// process can run on a level in total before being demoted
+static const uint level_quantum[NLEVELS] = {2, 5, 10, 20};
+
+static int proc_queued();
+static uint proc_level(struct process *proc);
+static void rt_set_runnable(struct process *proc, uint self);
+static void rt_miss(struct process *proc, ulonglong now);
+static void rt_leave(struct process *proc);
+static void timer_arm(ulonglong deadline);
+static void proc_exit();
+
+uint core_id() {
+    uint id;
+    asm("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
 
-// holds the set of all alive processes
-list_t proc_set;
+/**
+ * proc_switched_out: called on the stack of the next process once `prev` is
+ * switched out, so that other cores can run it again (or reap it if it has
+ * exited, which only this core may do).
+ */
+static void proc_switched_out(struct process *prev) {
+    if (prev == EGOSNULL || prev == proc_curr) return;
 
-queue_t runQ; // can be scheduled
-queue_t readyQ; // can be scheduled (for the first time)
+    // read status before clearing on_cpu, after which prev may run elsewhere
+    int zombie = (prev->status == PROC_ZOMBIE);
+    __atomic_store_n(&prev->on_cpu, 0, __ATOMIC_RELEASE);
+    if (zombie) proc_reap(prev);
 
-struct process *proc_curr, *proc_next;
+    // an idle core may have skipped prev on a runQ while it was switching out
+    // (this core arms its quantum timer for prev in proc_switch_aftermath())
+    else if (__atomic_load_n(&prev->queue, __ATOMIC_RELAXED) != EGOSNULL)
+        core_kick(prev->affinity & ~(1 << core_id()));
+}
 
 /**
  * proc_switch_aftermath: sets up kernel state after a process is switched to.
@@ -31,55 +58,112 @@ struct process *proc_curr, *proc_next;
  * `proc_next` is the process that was switched to.
  */
 void proc_switch_aftermath() {
+    struct process *proc_prev = proc_curr;
     proc_curr = proc_next;
-    earth->mmu_switch(proc_curr->pid);
-    earth->mmu_flush_cache();
-    earth->timer_reset(core_in_kernel);
+    proc_switched_out(proc_prev);
+    earth->mmu_switch(proc_curr->pid); // flushes the TLB and caches if needed
+    proc_curr->dispatch_time = mtime_get();
+    proc_curr->nswitch++;
+
+    // a real-time process runs until it has used its budget (or a process
+    // with an earlier deadline preempts it with an IPI), while preempting
+    // other processes is useless if no other process can be scheduled; such
+    // a tickless core gets an IPI from core_kick() once a process is queued,
+    // so set `tickless` before looking at the queues again
+    struct core *core = &cores[core_id()];
+    __atomic_store_n(&core->tickless, 0, __ATOMIC_RELAXED);
+    if (proc_curr->rt_period) {
+        timer_arm(proc_curr->dispatch_time + proc_curr->rt_remaining);
+        return;
+    }
+    if (!proc_queued()) {
+        __atomic_store_n(&core->tickless, 1, __ATOMIC_SEQ_CST);
+        if (!proc_queued()) {
+            timer_arm(TIMER_NEVER);
+            return;
+        }
+        __atomic_store_n(&core->tickless, 0, __ATOMIC_RELAXED);
+    }
+    timer_arm(proc_curr->dispatch_time + level_quantum[proc_level(proc_curr)] * QUANTUM);
 }
 
 /**
  * ctx_entry: simulate an interrupt, and return from interrupt to newly
  * scheduled process. This function is called on the kernel stack of the newly
- * created process (although the SP could also in essence be the boot/trap stack)
+ * created process, below the room ctx_start left for its first trap frame.
  */
 void ctx_entry() {
     proc_switch_aftermath();
+    if (proc_curr->killed) proc_exit();
+
+    // simulate an interrupt with a zeroed trap frame; app.s sets the stack
+    // pointer, so only the arguments of main() matter
+    struct trap_frame *tf = (void*)((uint)proc_curr->ksp - TRAP_FRAME_SIZE);
+    memset(tf, 0, sizeof(struct trap_frame));
+    tf->a[0] = APPS_ARG;     // address of argc
+    tf->a[1] = APPS_ARG + 4; // argv
 
-    // simulate an interrupt (could clear out other regs but i am lazy).
-    // app.s sets the stack pointer
     asm("csrw mepc, %0" ::"r"(APPS_ENTRY));
-    asm("csrw mscratch, %0"::"r"(proc_curr->ksp));
-    asm("mv a0, %0" ::"r"(APPS_ARG));     // address of argc
-    asm("mv a1, %0" ::"r"(APPS_ARG + 4)); // argv
-    asm("mret");
+    trap_return(tf);
 }
 
 static void intr_entry(uint);
 static void excp_entry(uint);
 
-void kernel_entry() {
-    asm("csrr %0, mhartid":"=r"(core_in_kernel));
-    asm("csrr %0, mepc":"=r"(proc_curr->mepc));
+#define INTR_ID_SOFT    3
+#define INTR_ID_TIMER   7
+#define EXCP_ID_ECALL_U 8
+#define EXCP_ID_ECALL_M 11
 
-    uint mcause;
+static void timer_defer(ulonglong deadline);
+
+void kernel_entry() {
+    uint mepc, mcause;
+    asm("csrr %0, mepc" : "=r"(mepc));
     asm("csrr %0, mcause" : "=r"(mcause));
+
+    // a process calling a grass function (e.g., sys_proc calling proc_alloc)
+    // may hold a kernel lock (e.g., proc_lock), so let it run one more
+    // QUANTUM; an IPI stays pending until cleared, so turn it into a timer
+    // interrupt
+    if ((mcause & (1 << 31)) &&
+        *(uint*)earth->mmu_translate(proc_curr->pid, (uint)LOCK_DEPTH)) {
+        if ((mcause & 0x3FF) == INTR_ID_SOFT) earth->ipi_clear(core_id());
+        timer_defer(mtime_get() + QUANTUM);
+        return;
+    }
+
+    trace(TRACE_TRAP, mcause);
+    proc_curr->mepc = mepc;
     (mcause & (1 << 31)) ? intr_entry(mcause & 0x3FF) : excp_entry(mcause);
 
     asm("csrw mepc, %0"::"r"(proc_curr->mepc));
 }
 
-#define INTR_ID_TIMER   7
-#define EXCP_ID_ECALL_U 8
-#define EXCP_ID_ECALL_M 11
-static void proc_yield(queue_t queue);
+#define RUNQ   EGOSNULL       // proc_yield(RUNQ) puts proc_curr back on a runQ
+#define SLEEPQ ((struct procq*)-1) // proc_yield(SLEEPQ) puts proc_curr on sleep_heap
+static void proc_yield(struct procq *queue);
+static void proc_yield_to(struct procq *queue, struct process *next);
 static void proc_try_syscall();
+static void sleep_expire(ulonglong now);
 
 static void excp_entry(uint id) {
     if (id == EXCP_ID_ECALL_U || id == EXCP_ID_ECALL_M) {
         proc_curr->mepc += 4;
-        memcpy(&proc_curr->syscall, (void*)SYSCALL_ARG, sizeof(struct syscall));
+        proc_curr->nsyscall++;
+
+        // copy the header, and only the part of content used by a message
+        struct syscall *sc = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_ARG);
+        memcpy(&proc_curr->syscall, sc, SYSCALL_HDR_LEN);
+        enum syscall_type type = proc_curr->syscall.type;
+        if (type == SYS_SEND || type == SYS_SEND_ASYNC || type == SYS_CALL ||
+            type == SYS_REPLY_WAIT) {
+            if (proc_curr->syscall.len > SYSCALL_MSG_LEN)
+                proc_curr->syscall.len = SYSCALL_MSG_LEN;
+            memcpy(proc_curr->syscall.content, sc->content, proc_curr->syscall.len);
+        }
         proc_try_syscall();
-        proc_yield(runQ);
+        proc_yield(RUNQ);
         return;
     }
 
@@ -87,91 +171,1034 @@ static void excp_entry(uint id) {
 }
 
 static void intr_entry(uint id) {
-    if (id == INTR_ID_TIMER) { proc_yield(runQ); return; }
+    if (id == INTR_ID_TIMER) {
+        cores[core_id()].ntimer++;
+        sleep_expire(mtime_get());
+        proc_yield(RUNQ);
+        return;
+    }
+
+    // an IPI from another core, e.g., proc_free() killing proc_curr
+    if (id == INTR_ID_SOFT) {
+        earth->ipi_clear(core_id());
+        proc_yield(RUNQ);
+        return;
+    }
     
     FATAL("intr_entry: proc %d got unknown id %d", proc_curr->pid, id);
 }
 
-static void proc_yield(queue_t queue) {
-    // push current process onto `queue` (can be runQ, or another queue)
-    queue_push(queue, proc_curr);
+/* * * * * * * */
+// priority inheritance: a server runs on the level of its highest client
+
+/* the level `proc` is scheduled on, which is at least its inherited level */
+static uint proc_level(struct process *proc) {
+    return proc->level < proc->inherited_level ? proc->level : proc->inherited_level;
+}
+
+/**
+ * proc_inherit: boost `server` to `level`, moving it up if it is waiting on
+ * a runQ. Called with the lock of `server` held.
+ */
+static void proc_inherit(struct process *server, uint level) {
+    uint old = proc_level(server);
+    if (level >= old) return;
+    server->inherited_level = level;
+
+    struct core *core = &cores[server->core];
+    acquire(core->lock);
+    if (server->queue >= core->runQ && server->queue < core->runQ + NLEVELS) {
+        procq_delete(server->queue, server);
+        procq_push(&core->runQ[level], server);
+    }
+    release(core->lock);
+}
+
+/**
+ * proc_disinherit: drop the level inherited by `server` to that of clients
+ * still waiting. Called with the lock of `server` held.
+ */
+static void proc_disinherit(struct process *server) {
+    server->inherited_level = NLEVELS;
+    for (struct process *p = server->senderQ.head; p != EGOSNULL; p = p->qnext)
+        if (proc_level(p) < server->inherited_level)
+            server->inherited_level = proc_level(p);
+}
+
+/* * * * * * * */
+// multi-level feedback queue with one set of runQs per core
 
-    // schedule another process (newest first)
-    if (queue_length(readyQ) > 0) {
-        queue_pop(readyQ, (void**)&proc_next);
+/* charge the time `proc` has been blocked in senderQ or msgwaitQ */
+static void proc_unblock(struct process *proc, ulonglong now) {
+    if (proc->block_start == 0) return;
+    proc->blocked_time += now - proc->block_start;
+    proc->block_start   = 0;
+}
+
+/**
+ * Every BOOST_PERIOD, proc_boost() moves the processes on runQs back to level
+ * 0 and bumps boost_epoch. Other processes (running or blocked) are moved
+ * back lazily by proc_epoch(), so proc_boost() does not walk proc_table.
+ * boost_lock is taken with no other lock held.
+ */
+static struct spinlock boost_lock;
+static ulonglong last_boost;
+static uint boost_epoch;
+
+static void proc_epoch(struct process *proc) {
+    uint epoch = __atomic_load_n(&boost_epoch, __ATOMIC_RELAXED);
+    if (proc->epoch == epoch) return;
+    proc->epoch = epoch;
+    proc->level = proc->used_at_level = 0;
+    // on level 0, an inherited level is moot until the next request anyway
+    proc->inherited_level = NLEVELS;
+}
+
+/**
+ * proc_home: the core whose runQ `proc` goes on, which is this core if
+ * `proc` may run here, or else the core it was last on if allowed, or else
+ * the first allowed core.
+ */
+static uint proc_home(struct process *proc, uint self) {
+    uint mask = proc->affinity & cores_booted();
+    if (mask == 0 || (mask & (1 << self))) return self;
+    if (mask & (1 << proc->core)) return proc->core;
+
+    uint core = 0;
+    while (!(mask & (1 << core))) core++;
+    return core;
+}
+
+static void proc_set_runnable(struct process *proc) {
+    uint self          = core_id();
+    uint home          = proc_home(proc, self);
+    proc->enqueue_time = mtime_get();
+    proc_unblock(proc, proc->enqueue_time);
+    if (proc->rt_period) {
+        rt_set_runnable(proc, self);
+        return;
+    }
+
+    acquire(cores[home].lock);
+    proc->core = home;
+    proc_epoch(proc);
+    procq_push(&cores[home].runQ[proc_level(proc)], proc);
+    release(cores[home].lock);
+
+    // proc_curr is still running here, see proc_switched_out() instead, and
+    // this core reschedules (and arms its quantum timer) after the trap
+    if (home != self)
+        core_wake(1 << home);
+    else if (proc != proc_curr)
+        core_kick(proc->affinity & ~(1 << self));
+}
+
+static void proc_boost(ulonglong now) {
+    if (now < last_boost + BOOST_PERIOD) return;
+    acquire(boost_lock);
+    if (now < last_boost + BOOST_PERIOD) {
+        release(boost_lock);
+        return;
+    }
+    last_boost = now;
+    __atomic_fetch_add(&boost_epoch, 1, __ATOMIC_RELAXED);
+
+    struct process *proc;
+    for (uint core = 0; core <= NCORES; core++) {
+        acquire(cores[core].lock);
+        for (uint level = 1; level < NLEVELS; level++)
+            while ((proc = procq_pop(&cores[core].runQ[level])) != EGOSNULL) {
+                proc_epoch(proc);
+                procq_push(&cores[core].runQ[0], proc);
+            }
+        release(cores[core].lock);
+    }
+    release(boost_lock);
+}
+
+static void sched_stats_update(uint level, ulonglong now) {
+    struct sched_stats *st = &cores[core_id()].stats[level];
+    ulonglong wait = now - proc_next->enqueue_time;
+    st->nsched++;
+    st->wait_total += wait;
+    if (wait > st->wait_max) st->wait_max = wait;
+}
+
+/* whether any process is queued, without locks (so only a hint) */
+static int proc_queued() {
+    if (procq_length(&readyQ)) return 1;
+    for (uint core = 0; core <= NCORES; core++) {
+        if (procq_length(&cores[core].rtQ)) return 1;
+        for (uint level = 0; level < NLEVELS; level++)
+            if (procq_length(&cores[core].runQ[level])) return 1;
+    }
+    return 0;
+}
+
+/**
+ * runq_take: take the first process on `q` which may run on core `self` and
+ * which no other core is running (or still switching out), and mark it as
+ * running on this core. Returns EGOSNULL if there is no such process.
+ */
+static struct process *runq_take(struct procq *q, uint self) {
+    if (procq_length(q) == 0) return EGOSNULL; // peek without the lock
+
+    acquire(*q->lock);
+    struct process *proc = q->head;
+    while (proc != EGOSNULL &&
+           (!(proc->affinity & (1 << self)) ||
+            (proc != proc_curr && __atomic_load_n(&proc->on_cpu, __ATOMIC_ACQUIRE))))
+        proc = proc->qnext;
+    if (proc != EGOSNULL) {
+        procq_delete(q, proc);
+        proc->on_cpu = 1;
+    }
+    release(*q->lock);
+    return proc;
+}
+
+/**
+ * proc_pick: choose proc_next for this core. Real-time processes admitted by
+ * this core go first, by earliest deadline, then new processes, then the
+ * highest level with a runnable process, taken from this core's runQ or,
+ * if empty, stolen from the runQ of another core on the same level. Only
+ * processes whose affinity includes this core are chosen.
+ * Returns -1 if no process can be scheduled.
+ */
+static int proc_pick(ulonglong now) {
+    uint self = core_id();
+    if ((proc_next = runq_take(&cores[self].rtQ, self)) != EGOSNULL) {
+        if (now > proc_next->rt_deadline) rt_miss(proc_next, now);
+        return 0;
+    }
+
+    if ((proc_next = runq_take(&readyQ, self)) != EGOSNULL) {
+        sched_stats_update(0, now);
+        return 0;
+    }
+
+    for (uint level = 0; level < NLEVELS; level++)
+        for (uint i = 0; i <= NCORES; i++) {
+            uint victim = (self + i) % (NCORES + 1);
+            if ((proc_next = runq_take(&cores[victim].runQ[level], self)) != EGOSNULL) {
+                sched_stats_update(level, now);
+                return 0;
+            }
+        }
+    return -1;
+}
+
+/**
+ * proc_switch: switch from proc_curr to proc_next, and return when proc_curr
+ * is switched back to (by this or another core).
+ */
+static void proc_switch() {
+    if (proc_next->status == PROC_NEW) {
+        proc_next->status = PROC_STARTED;
         ctx_start(&proc_curr->ksp, proc_next->ksp);
-        proc_switch_aftermath();
-    } 
-    else if (queue_length(runQ) > 0) {
-        queue_pop(runQ, (void**)&proc_next);
-        
+    } else {
         // both are pointers on purpose
         ctx_switch(&proc_curr->ksp, &proc_next->ksp);
-        proc_switch_aftermath();
     }
-    else {
-        FATAL("proc_yield: no more processes to schedule %x", proc_curr->pid);
+}
+
+/* * * * * * * */
+// sleeping processes in a min-heap on their wakeup time, shared by all
+// cores and protected by sleep_lock; whichever core takes the timer
+// interrupt wakes up the expired ones
+
+static struct spinlock sleep_lock;
+static struct process *sleep_heap[MAX_NPROCESS];
+static uint nsleeping;
+
+/* put `proc` into the hole at index i, moving it up or down as needed */
+static void sleep_sift(uint i, struct process *proc) {
+    while (i > 0 && sleep_heap[(i - 1) / 2]->wakeup_time > proc->wakeup_time) {
+        sleep_heap[i] = sleep_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    uint child;
+    while ((child = 2 * i + 1) < nsleeping) {
+        if (child + 1 < nsleeping &&
+            sleep_heap[child + 1]->wakeup_time < sleep_heap[child]->wakeup_time)
+            child++;
+        if (proc->wakeup_time <= sleep_heap[child]->wakeup_time) break;
+        sleep_heap[i] = sleep_heap[child];
+        i = child;
+    }
+    sleep_heap[i] = proc;
+}
+
+static void sleep_push(struct process *proc) { sleep_sift(nsleeping++, proc); }
+
+static void sleep_remove(uint i) {
+    struct process *last = sleep_heap[--nsleeping];
+    if (i < nsleeping) sleep_sift(i, last);
+}
+
+static struct process *sleep_pop() {
+    struct process *top = sleep_heap[0];
+    sleep_remove(0);
+    return top;
+}
+
+/* remove `proc` from sleep_heap; return -1 if it is not sleeping */
+static int sleep_delete(struct process *proc) {
+    for (uint i = 0; i < nsleeping; i++)
+        if (sleep_heap[i] == proc) {
+            sleep_remove(i);
+            return 0;
+        }
+    return -1;
+}
+
+static void sleep_expire(ulonglong now) {
+    while (nsleeping) {
+        acquire(sleep_lock);
+        struct process *proc = EGOSNULL;
+        if (nsleeping && sleep_heap[0]->wakeup_time <= now)
+            proc = sleep_pop();
+        release(sleep_lock);
+
+        if (proc == EGOSNULL) break;
+        proc_set_runnable(proc);
     }
 }
 
+/**
+ * timer_arm: program the timer of this core to fire at `deadline`, or
+ * earlier if a sleeping process needs to be woken up before that.
+ */
+static void timer_arm(ulonglong deadline) {
+    acquire(sleep_lock);
+    if (nsleeping && sleep_heap[0]->wakeup_time < deadline)
+        deadline = sleep_heap[0]->wakeup_time;
+    release(sleep_lock);
+    earth->timer_set(deadline, core_id());
+}
+
+/**
+ * timer_defer: like timer_arm(), but for kernel_entry() interrupting a
+ * process which may hold sleep_lock, so peek at the sleep heap without the
+ * lock. A stale peek only delays a wakeup until the next timer interrupt.
+ */
+static void timer_defer(ulonglong deadline) {
+    struct process *first = nsleeping ? sleep_heap[0] : EGOSNULL;
+    if (first != EGOSNULL && first->wakeup_time < deadline)
+        deadline = first->wakeup_time;
+    earth->timer_set(deadline, core_id());
+}
+
+/* * * * * * * */
+// real-time processes, scheduled earliest deadline first (EDF) on the core
+// which admitted them and ahead of the MLFQ; a process gets rt_budget of
+// CPU time in every rt_period, and is throttled until its next period once
+// it has used it up, which leaves the slack of every core to the MLFQ
+
+/* start the period of `proc` which includes `now`, with a full budget */
+static void rt_new_period(struct process *proc, ulonglong now) {
+    if (now >= proc->rt_deadline)
+        proc->rt_deadline += ((now - proc->rt_deadline) / proc->rt_period + 1) * proc->rt_period;
+    proc->rt_remaining = proc->rt_budget;
+}
+
+/* `proc` still had budget left at its deadline */
+static void rt_miss(struct process *proc, ulonglong now) {
+    proc->rt_misses++;
+    __atomic_fetch_add(&cores[proc->rt_core].rt_misses, 1, __ATOMIC_RELAXED);
+    rt_new_period(proc, now);
+}
+
+/* charge the time slice just used by `proc` to its budget */
+static void rt_charge(struct process *proc, ulonglong now) {
+    ulonglong ran      = now - proc->dispatch_time;
+    proc->rt_remaining = (ran < proc->rt_remaining) ? proc->rt_remaining - ran : 0;
+    if (now > proc->rt_deadline) {
+        if (proc->rt_remaining)
+            rt_miss(proc, now);
+        else
+            rt_new_period(proc, now);
+    }
+}
+
+/**
+ * rt_set_runnable: put `proc` on the rtQ of its core by deadline, or on
+ * sleep_heap until its next period if it has used up its budget. Preempt
+ * its core if that is another core, as `proc` may have the earliest deadline.
+ */
+static void rt_set_runnable(struct process *proc, uint self) {
+    ulonglong now = proc->enqueue_time;
+    if (now >= proc->rt_deadline) {
+        rt_new_period(proc, now);
+    } else if (proc->rt_remaining == 0) {
+        __atomic_fetch_add(&cores[proc->rt_core].rt_throttles, 1, __ATOMIC_RELAXED);
+        proc->wakeup_time = proc->rt_deadline;
+        acquire(sleep_lock);
+        sleep_push(proc);
+        release(sleep_lock);
+        return;
+    }
+
+    struct core *core = &cores[proc->rt_core];
+    acquire(core->lock);
+    struct process *next = core->rtQ.head;
+    while (next != EGOSNULL && next->rt_deadline <= proc->rt_deadline)
+        next = next->qnext;
+    procq_insert(&core->rtQ, next, proc);
+    release(core->lock);
+
+    if (proc->rt_core != self) core_wake(1 << proc->rt_core);
+}
+
+/* give the share of its core reserved by `proc` back */
+static void rt_leave(struct process *proc) {
+    if (proc->rt_period == 0) return;
+    acquire(cores[proc->rt_core].lock);
+    cores[proc->rt_core].rt_util -= proc->rt_util;
+    release(cores[proc->rt_core].lock);
+    proc->rt_period = proc->rt_util = 0;
+}
+
+/**
+ * rt_admit: make proc_curr a real-time process with `budget` usec in every
+ * `period` usec, reserving the share on this core if it fits within
+ * RT_MAX_UTIL, or else on the first allowed core where it fits.
+ * Returns -1 if the share fits on no allowed core.
+ */
+static int rt_admit(uint period, uint budget) {
+    if (budget == 0 || budget > period) return -1;
+    uint util = (uint)(((ulonglong)budget * 1000 + period - 1) / period);
+    uint mask = proc_curr->affinity & cores_booted();
+
+    for (uint i = 0; i <= NCORES; i++) {
+        uint core = (core_id() + i) % (NCORES + 1);
+        if (!(mask & (1 << core))) continue;
+
+        acquire(cores[core].lock);
+        int fits = (cores[core].rt_util + util <= RT_MAX_UTIL);
+        if (fits) cores[core].rt_util += util;
+        release(cores[core].lock);
+        if (!fits) continue;
+
+        proc_curr->rt_core      = core;
+        proc_curr->rt_util      = util;
+        proc_curr->rt_period    = (ulonglong)period * MTIME_TICKS_PER_USEC;
+        proc_curr->rt_budget    = (ulonglong)budget * MTIME_TICKS_PER_USEC;
+        proc_curr->rt_remaining = proc_curr->rt_budget;
+        proc_curr->rt_deadline  = mtime_get() + proc_curr->rt_period;
+        return 0;
+    }
+    return -1;
+}
+
 /* * * * * * * */
-// basically condition variables
+// killed processes exit by themselves the next time they run
 
-static void msg_wait() { proc_yield(proc_curr->msgwaitQ); }
+/**
+ * proc_zombie: make proc_curr a zombie, and let the processes blocked
+ * sending to it go on as if the messages were received.
+ */
+static void proc_zombie() {
+    struct process *sender;
+    rt_leave(proc_curr);
+    acquire(proc_curr->lock);
+    proc_curr->status = PROC_ZOMBIE;
+    while ((sender = procq_pop(&proc_curr->senderQ)) != EGOSNULL)
+        proc_set_runnable(sender);
+    release(proc_curr->lock);
+}
+
+/**
+ * proc_exit: switch away from proc_curr for the last time. The core that
+ * switches away reaps it in proc_switched_out().
+ */
+static void proc_exit() {
+    if (proc_curr->status != PROC_ZOMBIE) proc_zombie();
+    proc_yield(RUNQ);
+    FATAL("proc_exit: proc %d is switched back to", proc_curr->pid);
+}
+
+/**
+ * proc_wake_killed: called by proc_free() after marking `proc` as killed,
+ * so that `proc` runs soon if it is blocked (sending, receiving or sleeping).
+ * It pairs with the check of `killed` in proc_yield_to(): either `proc` sees
+ * that it is killed before blocking, or this function sees it blocked.
+ * This function is called by GPID_PROCESS, so it uses proc_set_ready().
+ */
+void proc_wake_killed(struct process *proc) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int woken = 0;
+    struct procq *q = __atomic_load_n(&proc->queue, __ATOMIC_RELAXED);
+    if (q != EGOSNULL) {
+        acquire(*q->lock);
+        woken = (proc->queue == q && procq_delete(q, proc) == 0);
+        release(*q->lock);
+    } else {
+        acquire(sleep_lock);
+        woken = (sleep_delete(proc) == 0);
+        release(sleep_lock);
+    }
+    if (woken) proc_set_ready(proc);
+}
+
+/**
+ * proc_yield_to: put proc_curr on `queue` and switch to `next`, or to the
+ * process chosen by proc_pick() if `next` is EGOSNULL. If `queue` is a
+ * procq, the caller holds queue->lock, which is released here once proc_curr
+ * is on `queue`.
+ */
+static void proc_yield_to(struct procq *queue, struct process *next) {
+    ulonglong now = mtime_get();
+    int exiting   = (proc_curr->status == PROC_ZOMBIE);
+
+    // charge the time slice just used, and demote proc_curr once it has
+    // used up the quantum of its level (whether or not it was preempted)
+    proc_epoch(proc_curr);
+    proc_curr->cpu_time += now - proc_curr->dispatch_time;
+    if (proc_curr->rt_period) {
+        rt_charge(proc_curr, now);
+    } else {
+        proc_curr->used_at_level += now - proc_curr->dispatch_time;
+        if (proc_curr->used_at_level >= level_quantum[proc_curr->level] * QUANTUM) {
+            proc_curr->used_at_level = 0;
+            if (proc_curr->level < NLEVELS - 1) proc_curr->level++;
+        }
+    }
+
+    // push current process onto `queue` (can be runQ, or another queue),
+    // unless it is killed meanwhile (see proc_wake_killed())
+    if (exiting)
+        ; // reaped by proc_switched_out() on the next stack
+    else if (queue == RUNQ)
+        proc_set_runnable(proc_curr);
+    else if (queue == SLEEPQ) {
+        acquire(sleep_lock);
+        sleep_push(proc_curr);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ((exiting = proc_curr->killed)) sleep_delete(proc_curr);
+        release(sleep_lock);
+    } else {
+        procq_push(queue, proc_curr);
+        proc_curr->block_start = now;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ((exiting = proc_curr->killed)) procq_delete(queue, proc_curr);
+        release(*queue->lock);
+    }
+    if (exiting && proc_curr->status != PROC_ZOMBIE) proc_zombie();
+
+    proc_boost(now);
+
+    // schedule another process, or let this core idle; `next` was taken off
+    // msgwaitQ by this core, but may still be switching out on another core
+    if (next != EGOSNULL) {
+        while (__atomic_load_n(&next->on_cpu, __ATOMIC_ACQUIRE));
+        next->on_cpu = 1;
+        proc_next    = next;
+    } else if (proc_pick(now) < 0) {
+        proc_next = &cores[core_id()].idle;
+    }
+    trace(TRACE_SWITCH, proc_next->pid);
+    proc_switch();
+    proc_switch_aftermath();
+    if (proc_curr->killed) proc_exit();
+}
+
+static void proc_yield(struct procq *queue) { proc_yield_to(queue, EGOSNULL); }
+
+/* * * * * * * */
+// idle loop of each core, woken up by an IPI when there is new work
+
+/* the mask of the cores which have booted (see core_idle_init()) */
+uint cores_booted() {
+    uint mask = 0;
+    for (uint core = 0; core <= NCORES; core++)
+        if (cores[core].idle.kstack != EGOSNULL) mask |= (1 << core);
+    return mask;
+}
+
+/* send an IPI to a core in `mask` which is idling (or else tickless) */
+static int core_kick_flagged(uint mask, int tickless) {
+    for (uint core = 0; core <= NCORES; core++) {
+        uint set = 1;
+        uint *f  = tickless ? &cores[core].tickless : &cores[core].idling;
+        if ((mask & (1 << core)) && *f &&
+            __atomic_compare_exchange_n(f, &set, 0, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            __atomic_fetch_add(&cores[core].nipi, 1, __ATOMIC_RELAXED);
+            earth->ipi_send(core);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * core_kick: send an IPI to one idle core in `mask`, if any, after a process
+ * is put on a queue, or else to one tickless core in `mask` (running a
+ * process without a quantum timer, see proc_switch_aftermath()), so that it
+ * preempts its process. Called by other cores and by GPID_PROCESS (so it
+ * reads no CSR). Clearing `idling` or `tickless` of the core makes sure that
+ * only one IPI is sent to it, and that the next process queued wakes up
+ * another core. Returns -1 if no core in `mask` is idle or tickless.
+ */
+int core_kick(uint mask) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (core_kick_flagged(mask, 0) == 0) return 0;
+    return core_kick_flagged(mask, 1);
+}
+
+/**
+ * core_wake: like core_kick(), but if no core in `mask` is idle or tickless
+ * while other cores are not in `mask`, preempt the first core in `mask` with
+ * an IPI. Otherwise a process pinned to busy cores could wait on a queue
+ * until the next quantum of those cores ends.
+ */
+void core_wake(uint mask) {
+    uint booted = cores_booted();
+    if (core_kick(mask) == 0 || (booted & ~mask) == 0) return;
+
+    for (uint core = 0; core <= NCORES; core++)
+        if (mask & booted & (1 << core)) {
+            __atomic_fetch_add(&cores[core].nipi, 1, __ATOMIC_RELAXED);
+            earth->ipi_send(core);
+            return;
+        }
+}
+
+/**
+ * proc_idle: the idle loop of a core, running on the idle context of the
+ * core with interrupts disabled. It parks the core in wfi until a process
+ * can be scheduled, and switches to it. When a process on this core blocks
+ * with nothing else to schedule, proc_yield() switches back here.
+ */
+void proc_idle() {
+    struct core *core = &cores[core_id()];
+    while (1) {
+        struct process *proc_prev = proc_curr;
+        proc_curr = proc_next;
+        proc_switched_out(proc_prev);
+        __atomic_store_n(&core->tickless, 0, __ATOMIC_RELAXED);
+
+        while (1) {
+            // set `idling` before looking for work, so that a process queued
+            // after proc_pick() looked at its queue comes with an IPI, which
+            // wakes up wfi even though interrupts are disabled
+            earth->ipi_clear(core_id());
+            __atomic_store_n(&core->idling, 1, __ATOMIC_SEQ_CST);
+            if (proc_pick(mtime_get()) == 0) break;
+
+            ulonglong idle_start = mtime_get();
+            timer_arm(TIMER_NEVER); // only for sleepers
+            asm("wfi");
+            __atomic_store_n(&core->idling, 0, __ATOMIC_RELAXED);
+            core->idle_time += mtime_get() - idle_start;
+            sleep_expire(mtime_get());
+        }
+        __atomic_store_n(&core->idling, 0, __ATOMIC_RELAXED);
+        trace(TRACE_SWITCH, proc_next->pid);
+        proc_switch();
+    }
+}
+
+/**
+ * core_idle_init: setup the idle context of core `core_id`, forging a frame
+ * of ctx_switch so that the first switch to it "returns" to `entry`.
+ */
+void core_idle_init(uint core_id, void (*entry)()) {
+    struct process *idle = &cores[core_id].idle;
+    idle->pid    = GPID_UNUSED;
+    idle->status = PROC_STARTED;
+    idle->kstack = egozalloc(SIZE_KSTACK);
+    idle->ksp    = (void*)((uint)idle->kstack + SIZE_KSTACK - CTX_FRAME_SIZE);
+
+    struct ctx_frame *frame = idle->ksp;
+    frame->ra = (uint)entry;
+
+    cores[core_id].lock.stats.enabled = 1;
+    cores[core_id].rtQ.lock           = &cores[core_id].lock;
+    for (uint level = 0; level < NLEVELS; level++)
+        cores[core_id].runQ[level].lock = &cores[core_id].lock;
+}
+
+/* * * * * * * */
+// scheduler information for the shell
+
+void proc_sched_info() {
+    for (uint level = 0; level < NLEVELS; level++) {
+        struct sched_stats st = {0};
+        for (uint core = 0; core <= NCORES; core++) {
+            struct sched_stats *cst = &cores[core].stats[level];
+            st.nsched     += cst->nsched;
+            st.wait_total += cst->wait_total;
+            if (cst->wait_max > st.wait_max) st.wait_max = cst->wait_max;
+        }
+        uint avg = st.nsched ? (uint)(st.wait_total / st.nsched) : 0;
+        printf("level %d: quantum %d, %d dispatches, ", level,
+               level_quantum[level], st.nsched);
+        printf("queueing latency avg %d max %d ticks\r\n", avg,
+               (uint)st.wait_max);
+    }
+
+    for (uint core = 0; core <= NCORES; core++) {
+        if (cores[core].idle.kstack == EGOSNULL) continue; // not booted
+        printf("core #%d: real-time utilization %d/1000, ", core, cores[core].rt_util);
+        printf("%d deadline misses, %d budgets used up\r\n",
+               cores[core].rt_misses, cores[core].rt_throttles);
+    }
+}
+
+void proc_lock_info() {
+    lock_stats_print("proc_lock", &proc_lock.stats);
+    lock_stats_print("ready_lock", &ready_lock.stats);
+    lock_stats_print("sleep_lock", &sleep_lock.stats);
+    for (uint core = 0; core <= NCORES; core++) {
+        if (cores[core].idle.kstack == EGOSNULL) continue; // not booted
+        printf("core #%d ", core);
+        lock_stats_print("runQ lock", &cores[core].lock.stats);
+    }
+}
+
+/* enable the statistics of the locks shown by proc_lock_info() */
+void proc_lock_init() {
+    proc_lock.stats.enabled  = 1;
+    ready_lock.stats.enabled = 1;
+    sleep_lock.stats.enabled = 1;
+}
+
+void proc_coresinfo() {
+    for (uint core = 0; core <= NCORES; core++) {
+        if (cores[core].idle.kstack == EGOSNULL) continue; // not booted
+        struct process *proc = cores[core].curr;
+        if (proc == EGOSNULL || proc->pid == GPID_UNUSED)
+            printf("core #%d: idle, ", core);
+        else
+            printf("core #%d: running process %d, ", core, proc->pid);
+        printf("idle for %d ticks, %d timer interrupts, %d IPIs\r\n",
+               (uint)cores[core].idle_time, cores[core].ntimer, cores[core].nipi);
+    }
+}
+
+/* * * * * * * */
+// basically condition variables, used with the lock of the receiver held
+
+static void msg_wait() {
+    trace(TRACE_WAIT, proc_curr->syscall.sender);
+    proc_yield(&proc_curr->msgwaitQ);
+}
 static void msg_notify(struct process *recipient) {
-    if (queue_length(recipient->msgwaitQ) == 0) 
+    if (procq_length(&recipient->msgwaitQ) == 0) 
         return;
-    if (queue_length(recipient->msgwaitQ) > 1)
+    if (procq_length(&recipient->msgwaitQ) > 1)
         FATAL("notify: more than one process on proc %d's msgwaitQ", recipient->pid);
     
-    queue_pop(recipient->msgwaitQ, EGOSNULL);
-    queue_push(runQ, recipient);
+    procq_pop(&recipient->msgwaitQ);
+    proc_set_runnable(recipient);
+}
+
+/* whether `recipient` is blocked in msg_wait() for a message from `sender` */
+static int msg_waiting_for(struct process *recipient, struct process *sender) {
+    return procq_length(&recipient->msgwaitQ) == 1 &&
+           (recipient->syscall.sender == GPID_ALL ||
+            recipient->syscall.sender == sender->pid);
+}
+
+/**
+ * proc_lock_receiver: find the receiver of proc_curr's message and return it
+ * with its lock held. Since proc_find() takes no lock, check again that the
+ * PCB still belongs to the receiver once it is locked.
+ */
+static struct process *proc_lock_receiver(char *caller) {
+    int pid = proc_curr->syscall.receiver;
+    struct process *receiver = proc_find(pid);
+    if (receiver != EGOSNULL) acquire(receiver->lock);
+
+    if (receiver == EGOSNULL || receiver->pid != pid || receiver->status == PROC_ZOMBIE)
+        FATAL("%s: proc %d sends to invalid proc %d", caller, proc_curr->pid, pid);
+    return receiver;
 }
 
 /* * * * * * * */
 
-static void proc_try_send() {
-    struct process *receiver = proc_pcb_find(proc_set, proc_curr->syscall.receiver);
+/**
+ * proc_try_send: send the message of proc_curr, which is either a request
+ * (`request` set), making a server receiver inherit the level of proc_curr,
+ * or the reply of a server, ending what the client inherited as a server.
+ */
+static void proc_try_send(int request) {
+    struct process *receiver = proc_lock_receiver("proc_try_send");
+    trace(TRACE_SEND, receiver->pid);
+    if (!request)
+        proc_disinherit(receiver);
+    else if (receiver->pid < GPID_USER_START)
+        proc_inherit(receiver, proc_level(proc_curr));
+
+    // direct handoff: the receiver is blocked waiting for this message, so
+    // switch to it right away instead of letting it wait on a runQ, unless
+    // it may not run on this core or is real-time (whose budget is charged
+    // on its rt_core), and then msg_notify() queues it on an allowed core
+    if (msg_waiting_for(receiver, proc_curr) &&
+        (receiver->affinity & (1 << core_id())) && !receiver->rt_period) {
+        procq_pop(&receiver->msgwaitQ);
+        proc_unblock(receiver, mtime_get());
+        proc_yield_to(&receiver->senderQ, receiver);
+        return;
+    }
+
     msg_notify(receiver);
-    proc_yield(receiver->senderQ);
+    proc_yield(&receiver->senderQ);
 }
 
-static void proc_try_recv() {
-    // wait until someone wants to send a message to us (the receiver)
-    while (!queue_length(proc_curr->senderQ))
-        msg_wait();
+/* * * * * * * */
+// messages buffered by sys_send_async, in a ring per receiver
+
+static int msg_ring_put(struct process *receiver) {
+    if (receiver->msgring == EGOSNULL)
+        receiver->msgring = egozalloc(sizeof(struct msg_ring));
+    struct msg_ring *ring = receiver->msgring;
+    if (ring->count == MSG_RING_SLOTS) return -1;
+
+    uint slot = (ring->head + ring->count++) % MSG_RING_SLOTS;
+    ring->slots[slot].sender = proc_curr->pid;
+    ring->slots[slot].len    = proc_curr->syscall.len;
+    memcpy(ring->slots[slot].content, proc_curr->syscall.content,
+           proc_curr->syscall.len);
+    return 0;
+}
+
+/**
+ * msg_ring_take: deliver the oldest message from `sender_pid` (or from any
+ * process if GPID_ALL) in the ring of proc_curr to its SYSCALL_ARG.
+ * Returns -1 if there is no such message.
+ */
+static int msg_ring_take(int sender_pid) {
+    struct msg_ring *ring = proc_curr->msgring;
+    if (ring == EGOSNULL) return -1;
+
+    for (uint i = 0; i < ring->count; i++) {
+        uint slot = (ring->head + i) % MSG_RING_SLOTS;
+        if (sender_pid != GPID_ALL && ring->slots[slot].sender != sender_pid)
+            continue;
+
+        struct syscall *sc = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_ARG);
+        sc->sender = ring->slots[slot].sender;
+        sc->bulk   = 0;
+        sc->len    = ring->slots[slot].len;
+        memcpy(sc->content, ring->slots[slot].content, sc->len);
+        trace(TRACE_RECV, sc->sender);
 
-    // attempt to find the desired sender from our senderQ
+        // the oldest message is taken by advancing the head, and a message
+        // taken from the middle (when filtering by sender) leaves a gap
+        if (i == 0) {
+            ring->head = (ring->head + 1) % MSG_RING_SLOTS;
+            ring->count--;
+            return 0;
+        }
+        for (; i + 1 < ring->count; i++) {
+            uint next = (ring->head + i + 1) % MSG_RING_SLOTS;
+            slot = (ring->head + i) % MSG_RING_SLOTS;
+            ring->slots[slot].sender = ring->slots[next].sender;
+            ring->slots[slot].len    = ring->slots[next].len;
+            memcpy(ring->slots[slot].content, ring->slots[next].content,
+                   ring->slots[next].len);
+        }
+        ring->count--;
+        return 0;
+    }
+    return -1;
+}
+
+/* * * * * * * */
+
+static void proc_try_send_async() {
+    struct process *receiver = proc_lock_receiver("proc_try_send_async");
+
+    // the ring of the receiver is full, so block like sys_send
+    if (msg_ring_put(receiver) < 0) {
+        release(receiver->lock);
+        proc_try_send(1);
+        return;
+    }
+    trace(TRACE_SEND, receiver->pid);
+    msg_notify(receiver);
+    release(receiver->lock);
+}
+
+static void proc_try_recv() {
     struct process *sender;
     int sender_pid = proc_curr->syscall.sender;
 
-    if (sender_pid == GPID_ALL) {
-        // take head of sendQ as the process that successfully sends to us
-        queue_pop(proc_curr->senderQ, (void**)&sender);
-    } else {
-        // wait until desired sender is on our senderQ, then delete
-        while ((sender = proc_pcb_find(proc_curr->senderQ, sender_pid)) == EGOSNULL)
-            msg_wait();
-        queue_delete(proc_curr->senderQ, sender);
-    }
+    // buffered messages go first, then wait until the desired sender (or
+    // anyone, if GPID_ALL) is on our senderQ; msg_wait() releases our lock
+    while (1) {
+        acquire(proc_curr->lock);
+        if (msg_ring_take(sender_pid) == 0) {
+            release(proc_curr->lock);
+            return;
+        }
 
-    // make sender runnable
-    queue_push(runQ, sender);
+        if (sender_pid == GPID_ALL) {
+            if ((sender = procq_pop(&proc_curr->senderQ)) != EGOSNULL) break;
+        } else {
+            sender = proc_find(sender_pid);
+            if (sender != EGOSNULL && sender->queue == &proc_curr->senderQ &&
+                sender->pid == sender_pid) {
+                procq_delete(&proc_curr->senderQ, sender);
+                break;
+            }
+        }
+        msg_wait();
+    }
+    release(proc_curr->lock);
 
     // transfer message from sender's PCB to receiver's userspace msg buffer
-    struct syscall *sc = (void*)SYSCALL_ARG;
+    struct syscall *sc = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_ARG);
     sc->sender = sender->pid;
-    memcpy(sc->content, sender->syscall.content, SYSCALL_MSG_LEN);
+    sc->bulk   = sender->syscall.bulk;
+    sc->len    = sender->syscall.len;
+    memcpy(sc->content, sender->syscall.content, sender->syscall.len);
+    trace(TRACE_RECV, sender->pid);
+
+    // hand the SYSCALL_BULK page of the sender over instead of copying it
+    _Static_assert(SYSCALL_BULK_LEN == PAGE_SIZE, "a bulk message is one page");
+    if (sender->syscall.bulk)
+        earth->mmu_swap(sender->pid, proc_curr->pid, SYSCALL_BULK / PAGE_SIZE);
+
+    // the sender is off every queue, so nobody else touches it until now
+    proc_set_runnable(sender);
+}
+
+static void proc_try_sleep() {
+    proc_curr->wakeup_time = mtime_get() +
+        (ulonglong)proc_curr->syscall.usec * MTIME_TICKS_PER_USEC;
+    proc_yield(SLEEPQ);
+}
+
+static void proc_try_rt_set() {
+    struct syscall *sc = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_ARG);
+    rt_leave(proc_curr);
+    sc->retval = proc_curr->syscall.budget ?
+                 rt_admit(proc_curr->syscall.usec, proc_curr->syscall.budget) : 0;
+}
+
+static void proc_try_call() {
+    proc_try_send(1);
+    // the server has taken the request, so wait for its reply
+    proc_curr->syscall.sender = proc_curr->syscall.receiver;
+    proc_try_recv();
+}
+
+static void proc_try_reply_wait() {
+    // the last request is served, so stop running on the level of its client
+    acquire(proc_curr->lock);
+    proc_disinherit(proc_curr);
+    release(proc_curr->lock);
+    if (proc_curr->syscall.receiver != GPID_UNUSED)
+        proc_try_send(0);
+    proc_curr->syscall.sender = GPID_ALL;
+    proc_try_recv();
+}
+
+/* * * * * * * */
+// batched system calls on the rings in the SYSCALL_RING page
+
+/* whether [vaddr, vaddr + len) is in the app region, where copy_to_user()
+ * may write; mmu_translate() does not check whether vaddr is mapped */
+static int user_range_ok(uint vaddr, uint len) {
+    return len == 0 || (vaddr >= APPS_ENTRY && vaddr < APPS_STACK_TOP &&
+                        len <= APPS_STACK_TOP - vaddr);
+}
+
+/* copy `len` bytes to `vaddr` in the address space of proc_curr */
+static void copy_to_user(uint vaddr, char *src, uint len) {
+    while (len) {
+        uint chunk = PAGE_SIZE - (vaddr % PAGE_SIZE);
+        if (chunk > len) chunk = len;
+        memcpy((void*)earth->mmu_translate(proc_curr->pid, vaddr), src, chunk);
+        vaddr += chunk, src += chunk, len -= chunk;
+    }
+}
+
+static void proc_try_ring_submit() {
+    struct syscall_ring *ring = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_RING);
+
+    while (ring->sq_head != ring->sq_tail &&
+           ring->cq_tail - ring->cq_head < SYSCALL_RING_ENTRIES) {
+        struct ring_sqe *sqe = &ring->sq[ring->sq_head % SYSCALL_RING_ENTRIES];
+        struct ring_cqe *cqe = &ring->cq[ring->cq_tail % SYSCALL_RING_ENTRIES];
+
+        // run the submission as if it came from SYSCALL_ARG
+        proc_curr->syscall.type     = sqe->type;
+        proc_curr->syscall.receiver = sqe->receiver;
+        proc_curr->syscall.bulk     = 0;
+        proc_curr->syscall.len      = (sqe->len < SYSCALL_RING_MSG_LEN) ?
+                                      sqe->len : SYSCALL_RING_MSG_LEN;
+        memcpy(proc_curr->syscall.content, sqe->content, proc_curr->syscall.len);
+
+        cqe->user_data = sqe->user_data;
+        cqe->sender    = cqe->len = 0;
+        switch (sqe->type) {
+            case SYS_SEND:
+                proc_try_send(1);
+                break;
+            case SYS_SEND_ASYNC:
+                proc_try_send_async();
+                break;
+            case SYS_CALL:
+                // fail the completion (sender GPID_UNUSED) instead of
+                // sending a request whose reply has nowhere to go
+                if (!user_range_ok((uint)sqe->reply_buf, sqe->reply_size) ||
+                    !user_range_ok((uint)sqe->bulk_buf, sqe->bulk_size)) {
+                    cqe->sender = GPID_UNUSED;
+                    break;
+                }
+                proc_try_call();
+                struct syscall *sc = (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_ARG);
+                cqe->sender = sc->sender;
+                cqe->len    = sc->len;
+                copy_to_user((uint)sqe->reply_buf, sc->content,
+                             (sc->len < sqe->reply_size) ? sc->len : sqe->reply_size);
+                if (sc->bulk)
+                    copy_to_user((uint)sqe->bulk_buf,
+                                 (void*)earth->mmu_translate(proc_curr->pid, SYSCALL_BULK),
+                                 (sqe->bulk_size < SYSCALL_BULK_LEN) ? sqe->bulk_size : SYSCALL_BULK_LEN);
+                break;
+            default:
+                FATAL("proc_try_ring_submit: proc %d submits unknown syscall type %d", \
+                        proc_curr->pid, sqe->type);
+        }
+        ring->sq_head++;
+        ring->cq_tail++;
+    }
 }
 
 static void proc_try_syscall() {
     switch (proc_curr->syscall.type) {
         case SYS_SEND:
-            proc_try_send();
+            proc_try_send(1);
             break;
         case SYS_RECV:
             proc_try_recv();
             break;
+        case SYS_SEND_ASYNC:
+            proc_try_send_async();
+            break;
+        case SYS_SLEEP:
+            proc_try_sleep();
+            break;
+        case SYS_CALL:
+            proc_try_call();
+            break;
+        case SYS_REPLY_WAIT:
+            proc_try_reply_wait();
+            break;
+        case SYS_RING_SUBMIT:
+            proc_try_ring_submit();
+            break;
+        case SYS_RT_SET:
+            proc_try_rt_set();
+            break;
         default:
             FATAL("proc_try_syscall: proc %d attempt unknown syscall type %d", \
                     proc_curr->pid, proc_curr->syscall.type);
@@ -6,68 +6,149 @@
  */
 
 #include "process.h"
-#include "list.h"
-extern list_t proc_set;
-extern queue_t runQ;
-extern queue_t readyQ;
+#include "trace.h"
+#include <string.h>
+extern struct procq readyQ;
 
-struct process *proc_found;
 /**
- * __proc_pcb_find_enumerate: will cast `item` into a process, and will set
- * `proc_found` to the current process being enumerated through if its PID
- * matches with `pid`
+ * proc_table: PID-indexed table of all alive processes. Process `pid` lives in
+ * slot PID_TO_SLOT(pid), so the high bits of a pid act as a generation counter
+ * for its slot, and a stale pid never matches the PCB now occupying the slot.
  */
-void __proc_pcb_find_enumerate(void *item, void *pid) {
-    if (item == EGOSNULL)
-        FATAL("__proc_pcb_find_enumerate: item is NULL (should be PCB)");
-    struct process *p = item;
-    if (p->pid == (int)pid)
-        proc_found = p;
-}
+struct process *proc_table[MAX_NPROCESS];
 
 /**
- * proc_pcb_find: find a process (in the `queue`) that matches `pid`. 
- * Returns EGOSNULL if a process with pid equal to `pid` is not found in `queue`
+ * proc_find: O(1) lookup of the PCB of process `pid`, without a lock.
+ * Returns EGOSNULL if no alive process has pid equal to `pid`. PCBs are
+ * recycled but never freed, so the caller may hold on to the PCB and check
+ * its pid again under the lock of the PCB.
  */
-struct process *proc_pcb_find(queue_t queue, int pid) {
-    proc_found = EGOSNULL;
-    queue_iterate(queue, __proc_pcb_find_enumerate, (void*)pid);
+struct process *proc_find(int pid) {
+    if (pid <= GPID_UNUSED) return EGOSNULL;
 
-    if (proc_found->pid != pid)
-        FATAL("proc_pcb_find: found proc %d instead of %d", proc_found->pid, pid);
-    return proc_found;
+    struct process *proc = __atomic_load_n(&proc_table[PID_TO_SLOT(pid)], __ATOMIC_ACQUIRE);
+    return (proc != EGOSNULL && proc->pid == pid) ? proc : EGOSNULL;
 }
 
+/*
+ * proc_alloc, proc_set_ready and proc_free are called by GPID_PROCESS, while
+ * other cores may be in the kernel, so they take the locks they need.
+ */
+
+struct spinlock proc_lock;
+extern struct spinlock ready_lock;
+
 void proc_set_ready(struct process *proc) { 
-    if (queue_push(readyQ, proc) < 0)
-        FATAL("proc_set_ready: failed to push proc %d onto readyQ", proc->pid);
+    acquire(ready_lock);
+    proc->enqueue_time = mtime_get();
+    procq_push(&readyQ, proc);
+    release(ready_lock);
+    core_wake(proc->affinity);
+}
+
+/**
+ * proc_pool: free PCBs which keep their kernel stack and msgring.
+ * proc_reap() recycles a PCB into the pool instead of freeing it, and the
+ * pool grows by a slab of PROC_SLAB PCBs (and their kernel stacks) in one
+ * allocation each, so spawning processes rarely touches the kernel heap.
+ */
+static struct process *proc_pool;
+
+static void proc_pool_grow() {
+    struct process *slab = egozalloc(PROC_SLAB * sizeof(struct process));
+    char *kstacks        = egosalloc(PROC_SLAB * SIZE_KSTACK);
+    if (slab == EGOSNULL || kstacks == EGOSNULL)
+        FATAL("proc_pool_grow: failed to alloc PCBs");
+
+    for (uint i = 0; i < PROC_SLAB; i++) {
+        struct process *proc = &slab[i];
+        proc->kstack    = kstacks + i * SIZE_KSTACK;
+        proc->pool_next = proc_pool;
+        proc_pool       = proc;
+    }
+}
+
+/**
+ * proc_pool_get: take a PCB from proc_pool and reset everything but what is
+ * recycled. A core may still hold the PCB of the previous process from
+ * proc_find(), so the reset is done under the lock of the PCB, which is
+ * kept as is.
+ */
+static struct process *proc_pool_get() {
+    if (proc_pool == EGOSNULL) proc_pool_grow();
+    struct process *proc = proc_pool;
+    proc_pool            = proc->pool_next;
+
+    acquire(proc->lock);
+    void *kstack             = proc->kstack;
+    struct msg_ring *msgring = proc->msgring;
+    memset((char*)proc + sizeof(struct spinlock), 0,
+           sizeof(struct process) - sizeof(struct spinlock));
+    proc->kstack   = kstack;
+    proc->msgring  = msgring;
+    if (msgring != EGOSNULL) msgring->head = msgring->count = 0;
+    proc->senderQ.lock  = &proc->lock;
+    proc->msgwaitQ.lock = &proc->lock;
+    release(proc->lock);
+    return proc;
 }
 
 /**
- * proc_alloc: alloc PCB and kernel stack of process, and push onto proc_list.
- * Returns NULL if OOM.
+ * proc_alloc: take a PCB with kernel stack from proc_pool, and insert it into
+ * proc_table. Pids keep increasing, skipping pids whose slot is still in use.
  */
 struct process *proc_alloc() {
     static uint curr_pid = 0;
+    acquire(proc_lock);
 
-    struct process *proc = egozalloc(sizeof(struct process));
-    if (proc == EGOSNULL)
-        FATAL("proc_alloc: failed to alloc PCB");
+    uint nprobe = 0;
+    do {
+        if (nprobe++ == MAX_NPROCESS)
+            FATAL("proc_alloc: reach the limit of %d processes", MAX_NPROCESS);
+        if (PID_TO_SLOT(++curr_pid) == 0) curr_pid++; /* slot of GPID_UNUSED */
+    } while (proc_table[PID_TO_SLOT(curr_pid)] != EGOSNULL);
 
-    proc->pid    = ++curr_pid;
-    proc->kstack = egosalloc(SIZE_KSTACK);
-    proc->ksp    = (void*)((uint)proc->kstack + SIZE_KSTACK);
+    struct process *proc  = proc_pool_get();
+    proc->pid             = curr_pid;
+    proc->inherited_level = NLEVELS;
+    proc->affinity        = CORES_ALL;
+    proc->ksp             = (void*)((uint)proc->kstack + SIZE_KSTACK);
 
-    proc->senderQ  = queue_new();
-    proc->msgwaitQ = queue_new();
-
-    list_append(proc_set, proc);
+    __atomic_store_n(&proc_table[PID_TO_SLOT(proc->pid)], proc, __ATOMIC_RELEASE);
+    trace_grass(TRACE_ALLOC, proc->pid, 0);
+    release(proc_lock);
     return proc;
 }
 
 /**
- * proc_free: free the memory associated with process `pid` and its PCB. This
- * function should only be called by GPID_PROCESS.
+ * proc_info: copy the CPU accounting of at most `max` processes to `info`.
+ * Returns the number of processes copied.
+ */
+uint proc_info(struct proc_info *info, uint max) {
+    uint n = 0;
+    acquire(proc_lock);
+    for (uint i = 0; i < MAX_NPROCESS && n < max; i++) {
+        struct process *proc = proc_table[i];
+        if (proc == EGOSNULL) continue;
+        info[n].pid          = proc->pid;
+        info[n].core         = proc->core;
+        info[n].level        = proc->level;
+        info[n].nswitch      = proc->nswitch;
+        info[n].nsyscall     = proc->nsyscall;
+        info[n].affinity     = proc->affinity;
+        info[n].cpu_time     = proc->cpu_time;
+        info[n].blocked_time = proc->blocked_time;
+        n++;
+    }
+    release(proc_lock);
+    return n;
+}
+
+/**
+ * proc_free: kill process `pid`. This function should only be called by
+ * GPID_PROCESS. The process is marked as killed and woken up if blocked, and
+ * it exits by itself the next time it runs on a core, which then reaps it.
+ * A core running the process gets an IPI to reschedule right away.
  * 
  * TODO: resolve any outstanding messages being sent to this process.
  */
@@ -77,20 +158,62 @@ void proc_free(int pid) {
     }
 
     struct process *proc_being_killed;
-    if ((proc_being_killed = proc_pcb_find(proc_set, pid)) == EGOSNULL)
+    if ((proc_being_killed = proc_find(pid)) == EGOSNULL)
         FATAL("proc_free: failed to find pcb of proc %d", pid);
+    trace_grass(TRACE_FREE, pid, 0);
 
-    if (queue_length(proc_being_killed->senderQ) > 0)
+    acquire(proc_being_killed->lock);
+    if (proc_being_killed->pid != pid)
+        FATAL("proc_free: failed to find pcb of proc %d", pid);
+    if (procq_length(&proc_being_killed->senderQ) > 0)
         FATAL("proc_free: non-empty senderQ of process being killed");
+    proc_being_killed->killed = 1;
+    release(proc_being_killed->lock);
+
+    proc_wake_killed(proc_being_killed);
+    for (uint core = 0; core <= NCORES; core++)
+        if (cores[core].curr == proc_being_killed)
+            earth->ipi_send(core);
+}
 
-    // remove from runQ (if there) and proc_set
-    queue_delete(runQ, proc_being_killed);
-    list_delete(proc_set, proc_being_killed);
-    
-    // free app memory, kernel stack, senderQ, msgwaitQ, and PCB
+/**
+ * proc_set_affinity: allow process `pid` to run only on the cores in `mask`.
+ * This function should only be called by GPID_PROCESS. A process running on
+ * a core outside `mask` is preempted with an IPI and moves, and a queued one
+ * is taken by an allowed core from the runQ it is on. Returns -1 if there is
+ * no such process, if no core in `mask` is booted, or if it is a real-time
+ * process.
+ */
+int proc_set_affinity(int pid, uint mask) {
+    struct process *proc = proc_find(pid);
+    if (proc == EGOSNULL || (mask & cores_booted()) == 0) return -1;
+    if (proc->rt_period) return -1; // stays on the core which admitted it
+
+    __atomic_store_n(&proc->affinity, mask, __ATOMIC_RELEASE);
+    if (proc->queue != EGOSNULL) core_wake(mask);
+
+    // a core which took proc before the new mask is set is switching to it
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (uint core = 0; core <= NCORES; core++)
+        if ((cores[core].curr == proc || cores[core].next == proc) &&
+            !(mask & (1 << core)))
+            earth->ipi_send(core);
+    return 0;
+}
+
+/**
+ * proc_reap: free a zombie which has exited and is not running on any core,
+ * and recycle its PCB into proc_pool. The zombie is on no queue, since it
+ * has exited by itself (see proc_exit() in kernel.c).
+ */
+void proc_reap(struct process *proc) {
+    int pid = proc->pid;
     earth->mmu_free(pid);
-    egosfree(proc_being_killed->kstack);
-    queue_free(proc_being_killed->senderQ);
-    queue_free(proc_being_killed->msgwaitQ);
-    egosfree(proc_being_killed);
+
+    // remove from proc_table, and keep kernel stack and msgring for reuse
+    acquire(proc_lock);
+    __atomic_store_n(&proc_table[PID_TO_SLOT(pid)], EGOSNULL, __ATOMIC_RELEASE);
+    proc->pool_next = proc_pool;
+    proc_pool       = proc;
+    release(proc_lock);
 }
@@ -1,24 +1,152 @@
 #pragma once
 
 #include "kmem.h"
-#include "queue.h"
-#include "list.h"
 #include "syscall.h"
+#include "frame.h"
 
 #define SIZE_KSTACK 0x4000 // default kernel stack size (16KB)
+#define PROC_SLAB   8      // PCBs allocated at a time by proc_alloc()
+#define PID_TO_SLOT(pid) ((uint)(pid) % MAX_NPROCESS)
 
+#define NLEVELS      4               // number of MLFQ priority levels
+#define BOOST_PERIOD (100 * QUANTUM) // move every process back to level 0
+#define MSG_RING_SLOTS 8             // messages buffered by sys_send_async
+#define RT_MAX_UTIL  900             // per-mille of a core for real-time
+                                     // processes, the rest is slack for others
+
+/* messages sent to a process with sys_send_async and not yet received */
+struct msg_ring {
+    uint head, count;
+    struct {
+        int sender;
+        uint len;
+        char content[SYSCALL_MSG_LEN];
+    } slots[MSG_RING_SLOTS];
+};
+
+/**
+ * procq: a FIFO queue of processes linked through the PCBs themselves, so
+ * push, pop and delete are O(1) and never allocate. A process is on at most
+ * one procq at a time (e.g., a runQ, readyQ, or another process's senderQ).
+ * Build with PROCQ_CHECK defined to check the invariants of a procq on every
+ * operation, see procq.c.
+ */
+struct procq {
+    struct process *head, *tail;
+    uint len;
+    struct spinlock *lock; // held to modify the queue
+};
+
+/**
+ * Locking: there is no big kernel lock. The locks below are taken in this
+ * order, and two locks of the same kind are never held at the same time.
+ *   1. proc_lock:        proc_table, pid allocation and proc_pool
+ *   2. process->lock:    senderQ, msgwaitQ, msgring and inherited_level of
+ *                        a process, i.e., its state as a receiver (a boost
+ *                        also resets inherited_level, see proc_epoch())
+ *   3. cores[i].lock:    the runQs of core #i (also ready_lock for readyQ,
+ *                        sleep_lock for the sleep heap)
+ *   4. leaf locks:       the kernel heap, mmu_lock of earth, trace_lock
+ * No lock is held across a context switch. Instead, a process which is on a
+ * queue may still be switching out on its core, with `on_cpu` set until the
+ * core is on the next stack, and no other core runs it before that.
+ */
 struct process {
+    struct spinlock lock; // must be the first field, see proc_pool_get()
     int pid;
+    enum { PROC_NEW, PROC_STARTED, PROC_ZOMBIE } status;
+    int core;  // the core whose runQ this process was last put on
+    uint affinity; // bit i is set if the process may run on core #i
+    uint on_cpu;  // being run by a core (including switching out)
+    uint killed;  // killed by proc_free(), exits the next time it runs
+    uint epoch;   // last boost_epoch applied to `level`
     uint mepc;
     struct syscall syscall;
-    queue_t senderQ;  // queue of processes that want to send a message to this process
-    queue_t msgwaitQ; // temporary place that a receiver can wait in until they get msg (INVARIANT: always at most one process on msgwaitQ)
+    struct procq senderQ;  // queue of processes that want to send a message to this process
+    struct procq msgwaitQ; // temporary place that a receiver can wait in until they get msg (INVARIANT: always at most one process on msgwaitQ)
+    struct procq *queue;          // the procq this process is on (NULL if none)
+    struct process *qprev, *qnext; // links within `queue`
+    struct msg_ring *msgring; // allocated at the first sys_send_async to this process
+    struct process *pool_next; // next free PCB in proc_pool
     void *kstack, *ksp;
+
+    uint level;               // MLFQ priority level (0 is the highest)
+    uint inherited_level;     // level inherited from clients (NLEVELS if none)
+    ulonglong used_at_level;  // mtime ticks run since entering `level`
+    ulonglong dispatch_time;  // mtime when last switched to
+    ulonglong enqueue_time;   // mtime when last put on readyQ or a runQ
+    ulonglong wakeup_time;    // mtime when a sleeping process is due
+
+    ulonglong cpu_time;       // mtime ticks run in total
+    ulonglong blocked_time;   // mtime ticks waited in senderQ or msgwaitQ
+    ulonglong block_start;    // mtime when last blocked (0 if not blocked)
+    uint nswitch;             // number of times switched to
+    uint nsyscall;            // number of system calls made
+
+    // real-time (EDF) class, see sys_rt_set(); times in mtime ticks
+    ulonglong rt_period;      // 0 if not a real-time process
+    ulonglong rt_budget;      // CPU time in every period
+    ulonglong rt_remaining;   // budget left in the current period
+    ulonglong rt_deadline;    // mtime when the current period ends
+    uint rt_util;             // per-mille of rt_core used by this process
+    uint rt_core;             // the core admitting this process
+    uint rt_misses;           // deadlines missed
+};
+
+/* queueing latency on each MLFQ level, from enqueue to dispatch */
+struct sched_stats {
+    uint nsched;
+    ulonglong wait_total, wait_max;
 };
 
+/* per-core scheduler state, indexed by hart id (hart #0 is unused on QEMU) */
+struct core {
+    struct process *curr, *next; // running and being switched to on this core
+    struct process idle;         // context of the idle loop of this core
+    struct spinlock lock;        // protects runQ, rtQ and rt_util
+    struct procq runQ[NLEVELS];  // can be scheduled (one queue per MLFQ level)
+    struct procq rtQ;            // real-time processes, by earliest deadline
+    uint rt_util;                // per-mille admitted to real-time processes
+    uint rt_misses, rt_throttles; // deadlines missed, budgets used up
+    struct sched_stats stats[NLEVELS]; // of the processes this core picked
+    ulonglong idle_time;         // mtime ticks spent in wfi
+    uint ntimer;                 // number of timer interrupts handled
+    uint idling;                 // in proc_idle() looking for work or in wfi
+    uint tickless;               // running a process without a quantum timer
+    uint nipi;                   // number of IPIs sent to this core
+};
+extern struct core cores[NCORES + 1];
+extern struct spinlock proc_lock;
+
+#define proc_curr (cores[core_id()].curr)
+#define proc_next (cores[core_id()].next)
+
+uint core_id();
 ulonglong mtime_get();
+void ctx_switch(void **old_sp, void **new_sp);
+void ctx_start(void **old_sp, void *new_sp);
+void trap_return(struct trap_frame *tf);
+
+void procq_push(struct procq *, struct process *);
+void procq_insert(struct procq *, struct process *before, struct process *);
+struct process *procq_pop(struct procq *);
+int procq_delete(struct procq *, struct process *);
+#define procq_length(q) ((q)->len)
 
 struct process *proc_alloc();
-struct process *proc_pcb_find(queue_t, int);
+struct process *proc_find(int);
 void proc_set_ready(struct process *);
 void proc_free(int);
+int proc_set_affinity(int, uint);
+uint proc_info(struct proc_info *, uint);
+void proc_reap(struct process *);
+void proc_wake_killed(struct process *);
+void proc_sched_info();
+void proc_coresinfo();
+void proc_lock_info();
+void proc_lock_init();
+void proc_idle();
+int core_kick(uint mask);
+void core_wake(uint mask);
+uint cores_booted();
+void core_idle_init(uint core_id, void (*entry)());
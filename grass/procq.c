@@ -0,0 +1,104 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: intrusive process queues for the scheduler
+ * The links of a procq live in struct process, so unlike library/libc/queue.c
+ * no operation allocates or frees memory. All operations are O(1) and are
+ * called with the lock of the procq held (see struct procq).
+ */
+
+#include "process.h"
+
+#ifdef PROCQ_CHECK
+#define check(x) do { if (!(x)) FATAL("procq: !!check failure at line %d", __LINE__); } while (0)
+
+/**
+ * procq_invariants: walk the whole queue and check that the links are
+ * consistent in both directions, that every process on it points back to it,
+ * and that `len` is the number of processes on it.
+ */
+static void procq_invariants(struct procq *q) {
+    check(q != EGOSNULL);
+    check((q->head == EGOSNULL) == (q->tail == EGOSNULL));
+
+    uint len = 0;
+    struct process *prev = EGOSNULL;
+    for (struct process *p = q->head; p != EGOSNULL; p = p->qnext) {
+        check(p->queue == q && p->qprev == prev);
+        check(++len <= MAX_NPROCESS);
+        prev = p;
+    }
+    check(prev == q->tail && len == q->len);
+}
+#else
+#define check(x)
+#define procq_invariants(q)
+#endif
+
+void procq_push(struct procq *q, struct process *proc) {
+    procq_invariants(q);
+    check(proc->queue == EGOSNULL);
+
+    proc->queue = q;
+    proc->qprev = q->tail;
+    proc->qnext = EGOSNULL;
+    if (q->tail != EGOSNULL)
+        q->tail->qnext = proc;
+    else
+        q->head = proc;
+    q->tail = proc;
+    q->len++;
+
+    procq_invariants(q);
+}
+
+/* put `proc` in front of `before` on `q`, or at the tail if `before` is NULL */
+void procq_insert(struct procq *q, struct process *before, struct process *proc) {
+    if (before == EGOSNULL) {
+        procq_push(q, proc);
+        return;
+    }
+    procq_invariants(q);
+    check(proc->queue == EGOSNULL && before->queue == q);
+
+    proc->queue = q;
+    proc->qprev = before->qprev;
+    proc->qnext = before;
+    if (before->qprev != EGOSNULL)
+        before->qprev->qnext = proc;
+    else
+        q->head = proc;
+    before->qprev = proc;
+    q->len++;
+
+    procq_invariants(q);
+}
+
+/* remove and return the first process of `q`, or NULL if `q` is empty */
+struct process *procq_pop(struct procq *q) {
+    struct process *proc = q->head;
+    if (proc != EGOSNULL) procq_delete(q, proc);
+    return proc;
+}
+
+/* remove `proc` from `q`; return -1 (and do nothing) if it is not on `q` */
+int procq_delete(struct procq *q, struct process *proc) {
+    procq_invariants(q);
+    if (proc->queue != q) return -1;
+
+    if (proc->qprev != EGOSNULL)
+        proc->qprev->qnext = proc->qnext;
+    else
+        q->head = proc->qnext;
+    if (proc->qnext != EGOSNULL)
+        proc->qnext->qprev = proc->qprev;
+    else
+        q->tail = proc->qprev;
+    q->len--;
+    proc->queue = EGOSNULL;
+    proc->qprev = proc->qnext = EGOSNULL;
+
+    procq_invariants(q);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: kernel trace
+ * Compact binary events with mtime timestamps go into a ring per core, so
+ * recording an event does not print anything or perturb timing much. The shell
+ * built-in `trace` dumps the rings in hex, and tools/tracedecode.c decodes
+ * the dump on the host.
+ */
+
+#include "process.h"
+#include "trace.h"
+
+/* ring #0 to #NCORES are indexed by hart id, and the last ring is for the
+ * grass functions which processes call (e.g., proc_alloc and disk wrappers)
+ * because those may run in user mode and cannot read mhartid */
+#define TRACE_RING_GRASS (NCORES + 1)
+static struct trace_ring trace_rings[NCORES + 2];
+static struct mcs_lock trace_lock;
+
+static void trace_put(struct trace_ring *ring, uint type, int pid, uint arg) {
+    struct trace_event *ev = &ring->events[ring->next++ % TRACE_NEVENTS];
+    ev->time = mtime_get();
+    ev->type = type;
+    ev->pid  = pid;
+    ev->arg  = arg;
+}
+
+/* trace: called by the kernel on this core, which alone writes its ring */
+void trace(uint type, uint arg) {
+    struct process *curr = proc_curr;
+    trace_put(&trace_rings[core_id()], type,
+              curr == EGOSNULL ? GPID_UNUSED : curr->pid, arg);
+}
+
+/* trace_grass: called by grass functions in the context of a process */
+void trace_grass(uint type, int pid, uint arg) {
+    struct mcs_node node;
+    mcs_acquire(&trace_lock, &node);
+    trace_put(&trace_rings[TRACE_RING_GRASS], type, pid, arg);
+    mcs_release(&trace_lock, &node);
+}
+
+static void (*earth_disk_read)(uint block_no, uint nblocks, char* dst);
+static void (*earth_disk_write)(uint block_no, uint nblocks, char* src);
+
+static void trace_disk_read(uint block_no, uint nblocks, char* dst) {
+    trace_grass(TRACE_DISK_READ, GPID_UNUSED, block_no);
+    earth_disk_read(block_no, nblocks, dst);
+    trace_grass(TRACE_DISK_DONE, GPID_UNUSED, nblocks);
+}
+
+static void trace_disk_write(uint block_no, uint nblocks, char* src) {
+    trace_grass(TRACE_DISK_WRITE, GPID_UNUSED, block_no);
+    earth_disk_write(block_no, nblocks, src);
+    trace_grass(TRACE_DISK_DONE, GPID_UNUSED, nblocks);
+}
+
+void trace_init() {
+    /* Wrap the earth disk interface, which is also used by sys_file. */
+    earth_disk_read   = earth->disk_read;
+    earth_disk_write  = earth->disk_write;
+    earth->disk_read  = trace_disk_read;
+    earth->disk_write = trace_disk_write;
+}
+
+void trace_dump() {
+    /* Each line is "trace RING TIME_HI TIME_LO TYPE PID ARG" in hex. */
+    for (uint r = 0; r <= TRACE_RING_GRASS; r++) {
+        struct trace_ring *ring = &trace_rings[r];
+        uint first = ring->next > TRACE_NEVENTS ? ring->next - TRACE_NEVENTS : 0;
+        for (uint i = first; i < ring->next; i++) {
+            struct trace_event *ev = &ring->events[i % TRACE_NEVENTS];
+            printf("trace %x %x %x %x %x %x\r\n", r, (uint)(ev->time >> 32),
+                   (uint)ev->time, ev->type, (uint)(ushort)ev->pid, ev->arg);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/* Kernel trace events, kept in a ring of TRACE_NEVENTS events per core and
+ * one more ring for grass functions called by processes. This header is
+ * also used by the host decoder in tools/tracedecode.c, so it only depends
+ * on plain C types. */
+
+#define TRACE_NEVENTS 256
+
+enum trace_type {
+    TRACE_UNUSED,
+    TRACE_TRAP,       /* arg: mcause                            */
+    TRACE_SWITCH,     /* arg: pid switched to (0 for idle)      */
+    TRACE_SEND,       /* arg: receiver pid                      */
+    TRACE_RECV,       /* arg: sender pid                        */
+    TRACE_WAIT,       /* arg: sender pid waited for (-1 if any) */
+    TRACE_ALLOC,      /* pid: the new process                   */
+    TRACE_FREE,       /* pid: the process being freed           */
+    TRACE_DISK_READ,  /* arg: first block number                */
+    TRACE_DISK_WRITE, /* arg: first block number                */
+    TRACE_DISK_DONE,  /* arg: number of blocks                  */
+    TRACE_NTYPES
+};
+
+struct trace_event {
+    unsigned long long time; /* mtime */
+    unsigned char type;      /* enum trace_type */
+    unsigned char unused;
+    short pid;               /* process running, unless noted above */
+    unsigned int arg;
+};
+
+struct trace_ring {
+    unsigned int next; /* total number of events ever put in the ring */
+    struct trace_event events[TRACE_NEVENTS];
+};
+
+void trace_init();
+void trace(unsigned int type, unsigned int arg);
+void trace_grass(unsigned int type, int pid, unsigned int arg);
+void trace_dump();
@@ -9,9 +9,13 @@ struct earth {
     uint (*mmu_alloc)();
     void (*mmu_free)(int pid);
     void (*mmu_flush_cache)();
-    void (*timer_reset)(uint core_id);
+    void (*timer_reset)(uint core_id, uint nquantum);
+    void (*timer_set)(ulonglong time, uint core_id);
+    void (*ipi_send)(uint core_id);
+    void (*ipi_clear)(uint core_id);
 
     void (*mmu_map)(int pid, uint vpage_no, uint ppage_id);
+    void (*mmu_swap)(int pid1, int pid2, uint vpage_no);
     uint (*mmu_translate)(int pid, uint vaddr);
     void (*mmu_switch)(int pid);
 
@@ -25,19 +29,27 @@ struct earth {
     enum { PAGE_TABLE, SOFT_TLB } translation;
 };
 
+struct proc_info;
 struct grass {
     struct process *(*proc_alloc)();
     void (*proc_set_ready)(struct process *proc);
     void (*proc_free)(int pid);
-
+    int (*proc_set_affinity)(int pid, uint mask);
+    uint (*proc_info)(struct proc_info* info, uint max);
+    void (*sched_info)();
+    void (*proc_coresinfo)();
+    void (*trace_dump)();
+    void (*lock_info)();
 
     void (*sys_send)(int receiver, char* msg, uint size);
     void (*sys_recv)(int from, int* sender, char* buf, uint size);
-    /* Student's code goes here (System Call | Multicore & Locks). */
-
-    /* Add interface functions for process sleep and multicore information. */
-
-    /* Student's code ends here. */
+    void (*sys_send_bulk)(int receiver, char* msg, uint size);
+    void (*sys_call)(int server, char* msg, uint size, char* buf, uint buf_size);
+    void (*sys_reply_wait)(int client, char* msg, uint size, int* sender,
+                           char* buf, uint buf_size);
+    void (*sys_reply_bulk_wait)(int client, char* msg, uint size, int* sender,
+                                char* buf, uint buf_size);
+    void (*sys_sleep)(uint usec);
 };
 
 extern struct earth* earth;
@@ -49,6 +61,8 @@ extern struct grass* grass;
 #define RAM_END           0x81000000 /* 16MB memory [0x80000000,0x81000000) */
 #define APPS_PAGES_BASE   0x80800000 /* 8MB free for mmu_alloc              */
 #define APPS_STACK_TOP    0x80800000 /* 2MB app stack (growing down)        */
+#define SYSCALL_RING      0x80604000 /* submission and completion rings     */
+#define SYSCALL_BULK      0x80603000 /* page moved by sys_send_bulk()       */
 #define SHELL_WORK_DIR    0x80602000 /* current work directory for shell    */
 #define SYSCALL_ARG       0x80601000 /* struct syscall                      */
 #define APPS_ARG          0x80600000 /* main() arguments (argc and argv)    */
@@ -58,6 +72,7 @@ extern struct grass* grass;
 #define EARTH_STRUCT_BASE 0x80200000 /* struct earth                        */
 #define RAM_START         0x80000000 /* 2MB egos code and data              */
 #define BOARD_FLASH_ROM   0x20400000 /* 4MB disk image on Arty board ROM    */
+#define PAGE_SIZE         4096       /* of mmu_alloc() and Sv32 page tables */
 
 /* Below is the memory-mapped I/O layout in egos-2000. */
 #define ETHMAC_CSR_BASE  0xF0002000
@@ -67,15 +82,23 @@ extern struct grass* grass;
 #define UART_BASE        (earth->platform == ARTY ? 0xF0001000UL : 0x10010000UL)
 #define CLINT_BASE       (earth->platform == ARTY ? 0xF0010000UL : 0x02000000UL)
 
+/* Below is the time slice unit of the scheduler, measured in mtime ticks. */
+#define QUANTUM     (earth->platform == QEMU ? 100000UL : 50000000UL)
+#define TIMER_NEVER 0xFFFFFFFFFFFFFFFFULL /* timer_set() for no interrupt */
+#define MTIME_TICKS_PER_USEC (earth->platform == QEMU ? 10 : 100)
+
 /* Below are some common macros/declarations for I/O, multicore and printing. */
 #define ACCESS(x)          (*(__typeof__(*x) volatile*)(x))
 #define REGW(base, offset) (ACCESS((uint*)(base + offset)))
 #define REGB(base, offset) (ACCESS((uchar*)(base + offset)))
 
-#define NCORES     4
-#define release(x) __sync_lock_release(&x);
-#define acquire(x) while (__sync_lock_test_and_set(&x, 1) != 0);
-extern int boot_lock, kernel_lock, booted_core_cnt;
+#define NCORES       4
+#define MAX_NPROCESS 256 /* at most 256 processes alive at the same time */
+#include "spinlock.h"
+#define release(x)   spin_release(&(x))
+#define acquire(x)   spin_acquire(&(x))
+extern struct spinlock boot_lock;
+extern int booted_core_cnt;
 
 #define printf my_printf
 int INFO(const char* format, ...);
@@ -11,7 +11,6 @@
 #include "servers.h"
 #include <string.h>
 
-#define PAGE_SIZE          4096
 #define PAGE_ID_TO_ADDR(x) ((char*)APPS_PAGES_BASE + x * PAGE_SIZE)
 
 void elf_load(int pid, elf_reader reader, int argc, void** argv) {
@@ -69,9 +68,19 @@ void elf_load(int pid, elf_reader reader, int argc, void** argv) {
         argv_addr[i] = APPS_ARG + sizeof(uint) /* argc */ +
                        sizeof(void*) * CMD_NARGS /* argv */ + i * CMD_ARG_LEN;
 
-    /* Setup a page for system call arguments. */
+    /* Setup a page for system call arguments, which also holds LOCK_DEPTH. */
     ppage_id = earth->mmu_alloc();
     earth->mmu_map(pid, SYSCALL_ARG / PAGE_SIZE, ppage_id);
+    memset(PAGE_ID_TO_ADDR(ppage_id), 0, PAGE_SIZE);
+
+    /* Setup a page for bulk messages (see sys_send_bulk). */
+    ppage_id = earth->mmu_alloc();
+    earth->mmu_map(pid, SYSCALL_BULK / PAGE_SIZE, ppage_id);
+
+    /* Setup a page for the system call rings (see sys_ring_submit). */
+    ppage_id = earth->mmu_alloc();
+    earth->mmu_map(pid, SYSCALL_RING / PAGE_SIZE, ppage_id);
+    memset(PAGE_ID_TO_ADDR(ppage_id), 0, PAGE_SIZE);
 
     /* Setup 2 pages for user stack (enough for teaching purpose). */
     for (uint i = 1; i <= 2; i++) {
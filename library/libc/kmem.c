@@ -8,6 +8,10 @@
 /* in the data segment of the kernel */
 memregion_info_t freelisthead = MAGIC;
 
+/* the kernel heap is shared by the cores (and by grass functions called by
+ * system processes), so the free list is protected by kmem_lock */
+static struct spinlock kmem_lock;
+
 /**
  * __memregion_split: Create a new region of `size` bytes inside the data portion
  * of the memory region `region`. Returns a pointer to the base of the newly constructed 
@@ -94,8 +98,11 @@ memregion_info_t __freelist_find(uint size) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 void *egosalloc(uint size) {
+    acquire(kmem_lock);
     if (freelisthead == MAGIC) __freelist_setup();
-    return (void*)((uint)__freelist_find(size) + sizeof(struct memregion_info));
+    memregion_info_t region = __freelist_find(size);
+    release(kmem_lock);
+    return (void*)((uint)region + sizeof(struct memregion_info));
 }
 
 void *egozalloc(uint size) {
@@ -105,5 +112,7 @@ void *egozalloc(uint size) {
 }
 
 void egosfree(void *ptr) {
+    acquire(kmem_lock);
     __freelist_push((memregion_info_t)((uint)ptr - sizeof(struct memregion_info)));
+    release(kmem_lock);
 }
\ No newline at end of file
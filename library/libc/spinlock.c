@@ -0,0 +1,107 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: ticket and MCS spinlocks with optional statistics
+ */
+
+#include "kmem.h"
+
+/* read mtime directly, since mtime_get() of earth is not linked into apps */
+static ulonglong lock_mtime() {
+    uint low, high;
+    do {
+        high = REGW(CLINT_BASE, 0xBFFC);
+        low  = REGW(CLINT_BASE, 0xBFF8);
+    } while (REGW(CLINT_BASE, 0xBFFC) != high);
+    return (((ulonglong)high) << 32) | low;
+}
+
+/* called with the lock held, after waiting for `nspin` iterations */
+static void stats_acquired(struct lock_stats *stats, uint nspin) {
+    if (!stats->enabled) return;
+    stats->nacquire++;
+    stats->nspin += nspin;
+    if (nspin) stats->ncontended++;
+    stats->acquire_time = lock_mtime();
+}
+
+/* called with the lock held, right before releasing it */
+static void stats_release(struct lock_stats *stats) {
+    if (!stats->enabled) return;
+    ulonglong hold = lock_mtime() - stats->acquire_time;
+    if (hold > stats->max_hold) stats->max_hold = hold;
+}
+
+/* count the locks of a process, which runs on its stack in the app region,
+ * in LOCK_DEPTH (on a kernel stack, interrupts are disabled anyway) */
+static uint *lock_depth() {
+    uint sp;
+    asm("mv %0, sp" : "=r"(sp));
+    return (sp >= APPS_ENTRY && sp < APPS_STACK_TOP) ? LOCK_DEPTH : EGOSNULL;
+}
+
+static void lock_taking() {
+    uint *depth = lock_depth();
+    if (depth != EGOSNULL) (*depth)++;
+}
+
+static void lock_released() {
+    uint *depth = lock_depth();
+    if (depth != EGOSNULL) (*depth)--;
+}
+
+void spin_acquire(struct spinlock *lock) {
+    lock_taking();
+    uint ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+
+    uint nspin = 0;
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) nspin++;
+    stats_acquired(&lock->stats, nspin);
+}
+
+void spin_release(struct spinlock *lock) {
+    stats_release(&lock->stats);
+    /* only the holder writes owner, so a plain increment is enough */
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+    lock_released();
+}
+
+void mcs_acquire(struct mcs_lock *lock, struct mcs_node *node) {
+    lock_taking();
+    node->next   = EGOSNULL;
+    node->locked = 1;
+
+    uint nspin = 0;
+    struct mcs_node *pred = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+    if (pred != EGOSNULL) {
+        /* link behind the predecessor, which clears `locked` on release */
+        __atomic_store_n(&pred->next, node, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) nspin++;
+    }
+    stats_acquired(&lock->stats, nspin);
+}
+
+void mcs_release(struct mcs_lock *lock, struct mcs_node *node) {
+    stats_release(&lock->stats);
+
+    struct mcs_node *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if (next == EGOSNULL) {
+        /* no waiter, unless one has swapped tail but not linked itself yet */
+        struct mcs_node *expected = node;
+        if (__atomic_compare_exchange_n(&lock->tail, &expected, EGOSNULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            lock_released();
+            return;
+        }
+        while ((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == EGOSNULL);
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+    lock_released();
+}
+
+void lock_stats_print(const char *name, struct lock_stats *stats) {
+    printf("%s: %d acquisitions, %d contended, %d spins, ", name,
+           stats->nacquire, stats->ncontended, stats->nspin);
+    printf("max hold %d ticks\r\n", (uint)stats->max_hold);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+ * Spinlocks shared by the cores
+ *
+ * A ticket lock hands itself to the cores in the order they asked for it,
+ * and a waiter spins on reading `owner` instead of writing the cache line of
+ * the lock over and over like test-and-set. An MCS lock goes further: every
+ * waiter brings a node and spins on its own node, so a release only touches
+ * the cache line of the next waiter.
+ *
+ * The lock functions are in the library, so they can be called in any
+ * privilege mode (e.g., by system processes in user mode).
+ */
+
+/*
+ * Statistics of a lock, collected only if `enabled` is set. The hold time
+ * is measured in mtime ticks from acquire to release.
+ */
+struct lock_stats {
+    uint enabled;
+    uint nacquire;          // number of acquisitions
+    uint ncontended;        // acquisitions which had to wait
+    uint nspin;             // iterations spent waiting in total
+    ulonglong acquire_time; // mtime of the last acquisition
+    ulonglong max_hold;     // longest time the lock was held
+};
+
+/* ticket lock (earth/boot.s relies on `next` and `owner` being first) */
+struct spinlock {
+    uint next;  // next ticket to hand out
+    uint owner; // ticket holding the lock
+    struct lock_stats stats;
+};
+
+/* MCS lock, and the node which a core brings to acquire it */
+struct mcs_node {
+    struct mcs_node *next;
+    uint locked;
+};
+struct mcs_lock {
+    struct mcs_node *tail;
+    struct lock_stats stats;
+};
+
+/*
+ * The number of locks held by the running process, in the last word of its
+ * SYSCALL_ARG page. Kernel code runs with interrupts disabled, but a process
+ * calling a grass function (e.g., sys_proc calling proc_alloc) takes kernel
+ * locks too, and kernel_entry() does not preempt it while it holds any.
+ */
+#define LOCK_DEPTH ((uint*)(SYSCALL_ARG + PAGE_SIZE) - 1)
+
+void spin_acquire(struct spinlock *lock);
+void spin_release(struct spinlock *lock);
+
+/* The same `node` must be passed to mcs_release(), and stay valid until then. */
+void mcs_acquire(struct mcs_lock *lock, struct mcs_node *node);
+void mcs_release(struct mcs_lock *lock, struct mcs_node *node);
+
+/* Print the statistics of a lock on one line. */
+void lock_stats_print(const char *name, struct lock_stats *stats);
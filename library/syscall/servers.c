@@ -11,25 +11,17 @@
 #include <stdlib.h>
 #include <string.h>
 
-static int sender;
 static char buf[SYSCALL_MSG_LEN];
 
 void exit(int status) {
     struct proc_request req;
     req.type = PROC_EXIT;
+    term_flush();
     sys_send(GPID_PROCESS, (void*)&req, sizeof(req));
     while (1);
 }
 
-void sleep(uint usec) {
-    /* Student's code goes here (System Call & Protection). */
-
-    /* Send a message to GPID_PROCESS for process sleep. For simplicity,
-     * you can assume that GPID_PROCESS will be scheduled and handle the
-     * message before the kernel re-schedules the current process. */
-
-    /* Student's code ends here. */
-}
+void sleep(uint usec) { sys_sleep(usec); }
 
 int dir_lookup(int dir_ino, char* name) {
     char buf[BLOCK_SIZE];
@@ -50,15 +42,46 @@ int file_read(int file_ino, uint offset, char* block) {
     req.ino    = file_ino;
     req.offset = offset;
 
-    sys_send(GPID_FILE, (void*)&req, sizeof(req));
-    sys_recv(GPID_FILE, &sender, buf, SYSCALL_MSG_LEN);
+    sys_call(GPID_FILE, (void*)&req, sizeof(req) - sizeof(block_t), buf,
+             sizeof(struct file_reply));
 
     struct file_reply* reply = (void*)buf;
-    memcpy(block, reply->block.bytes, BLOCK_SIZE);
+    memcpy(block, (void*)SYSCALL_BULK, BLOCK_SIZE);
 
     return reply->status == FILE_OK ? 0 : -1;
 }
 
+int file_read_batch(int file_ino, uint offset, uint nblocks, char* dst) {
+    /* Queue one FILE_READ call per block, and run them with one trap. */
+    struct file_reply reply[SYSCALL_RING_ENTRIES];
+    struct ring_sqe* sqe;
+    for (uint i = 0; i < nblocks && (sqe = sys_ring_sqe()) != NULL; i++) {
+        struct file_request* req = (void*)sqe->content;
+        req->type       = FILE_READ;
+        req->ino        = file_ino;
+        req->offset     = offset + i;
+        sqe->type       = SYS_CALL;
+        sqe->receiver   = GPID_FILE;
+        sqe->len        = sizeof(*req) - sizeof(block_t);
+        sqe->user_data  = i;
+        sqe->reply_buf  = (void*)&reply[i];
+        sqe->reply_size = sizeof(reply[i]);
+        sqe->bulk_buf   = dst + i * BLOCK_SIZE;
+        sqe->bulk_size  = BLOCK_SIZE;
+    }
+    sys_ring_submit();
+
+    /* Return the number of blocks read before the first failure. */
+    uint nread = 0, failed = 0;
+    struct ring_cqe cqe;
+    while (sys_ring_cqe(&cqe) == 0)
+        if (reply[cqe.user_data].status == FILE_OK && !failed)
+            nread++;
+        else
+            failed = 1;
+    return nread;
+}
+
 #ifndef KERNEL
 
 /* Terminal read/write for user applications send messages to GPID_TERMINAL. */
@@ -67,8 +90,8 @@ int term_read(char* buf, uint len) {
     struct term_reply reply;
     req.type = TERM_INPUT;
     req.len  = len;
-    sys_send(GPID_TERMINAL, (void*)&req, sizeof(req));
-    sys_recv(GPID_TERMINAL, NULL, (void*)&reply, sizeof(reply));
+    sys_call(GPID_TERMINAL, (void*)&req, sizeof(req) - TERM_BUF_SIZE,
+             (void*)&reply, sizeof(reply));
     memcpy(buf, reply.buf, reply.len);
     return reply.len;
 }
@@ -78,7 +101,16 @@ void term_write(char* str, uint len) {
     req.type = TERM_OUTPUT;
     req.len  = len;
     memcpy(req.buf, str, len);
-    sys_send(GPID_TERMINAL, (void*)&req, sizeof(req));
+    sys_send_async(GPID_TERMINAL, (void*)&req, sizeof(req) - TERM_BUF_SIZE + len);
+}
+
+void term_flush() {
+    /* GPID_TERMINAL receives buffered messages first, so a synchronous
+     * send returns after all the output of term_write has been written. */
+    struct term_request req;
+    req.type = TERM_OUTPUT;
+    req.len  = 0;
+    sys_send(GPID_TERMINAL, (void*)&req, sizeof(req) - TERM_BUF_SIZE);
 }
 
 #else
@@ -111,4 +143,6 @@ void term_write(char* str, uint len) {
     for (uint i = 0; i < len; i++) earth->tty_write(str[i]);
 }
 
+void term_flush() {}
+
 #endif
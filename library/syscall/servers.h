@@ -4,8 +4,10 @@ void exit(int status);
 void sleep(uint usec);
 int term_read(char* buf, uint len);
 void term_write(char* str, uint len);
+void term_flush();
 int dir_lookup(int dir_ino, char* name);
 int file_read(int file_ino, uint offset, char* block);
+int file_read_batch(int file_ino, uint offset, uint nblocks, char* dst);
 
 enum grass_servers {
     GPID_ALL = -1,
@@ -20,21 +22,37 @@ enum grass_servers {
 /* GPID_PROCESS */
 #define CMD_NARGS   16
 #define CMD_ARG_LEN 32
+#define CORES_ALL   0xFFFFFFFF /* affinity of a process allowed on any core */
 
 struct proc_request {
-    /* Student's code goes here (System Call & Protection). */
-
-    /* Update struct proc_request to support process sleep. */
-    enum { PROC_SPAWN, PROC_EXIT, PROC_KILLALL } type;
+    enum { PROC_SPAWN, PROC_EXIT, PROC_KILLALL, PROC_INFO, PROC_SET_AFFINITY } type;
     int argc;
     char argv[CMD_NARGS][CMD_ARG_LEN];
-    /* Student's code ends here. */
+    int pid;       /* PROC_SET_AFFINITY */
+    uint affinity; /* bit i for core #i, or 0 for CORES_ALL at PROC_SPAWN
+                      (e.g., from `@CORES COMMAND` in the shell) */
 };
 
 struct proc_reply {
     enum { CMD_OK, CMD_ERROR } type;
 };
 
+/* Reply of PROC_INFO, with times in mtime ticks. */
+#define PROC_INFO_MAX 24
+struct proc_info {
+    int pid;
+    uint core, level;
+    uint nswitch, nsyscall;
+    uint affinity;
+    ulonglong cpu_time;     /* time running on a core */
+    ulonglong blocked_time; /* time waiting in senderQ or msgwaitQ */
+};
+
+struct proc_info_reply {
+    uint nprocs;
+    struct proc_info procs[PROC_INFO_MAX];
+};
+
 /* GPID_TERMINAL */
 #define TERM_BUF_SIZE 512
 struct term_request {
@@ -61,7 +79,7 @@ struct file_request {
     block_t block;
 };
 
+/* The block read is sent in the SYSCALL_BULK page (see sys_send_bulk). */
 struct file_reply {
     enum file_status { FILE_OK, FILE_ERROR } status;
-    block_t block;
 };
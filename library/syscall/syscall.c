@@ -11,10 +11,33 @@
 
 static struct syscall* sc = (struct syscall*)SYSCALL_ARG;
 
-void sys_send(int receiver, char* msg, uint size) {
-    sc->type     = SYS_SEND;
+static void sys_msg_set(int receiver, char* msg, uint size, uint bulk) {
     sc->receiver = receiver;
+    sc->bulk     = bulk;
+    sc->len      = size;
     memcpy(sc->content, msg, size);
+}
+
+static void sys_msg_get(int* sender, char* buf, uint size) {
+    memcpy(buf, sc->content, size < sc->len ? size : sc->len);
+    if (sender) *sender = sc->sender;
+}
+
+void sys_send(int receiver, char* msg, uint size) {
+    sc->type = SYS_SEND;
+    sys_msg_set(receiver, msg, size, 0);
+    asm("ecall");
+}
+
+void sys_send_bulk(int receiver, char* msg, uint size) {
+    sc->type = SYS_SEND;
+    sys_msg_set(receiver, msg, size, 1);
+    asm("ecall");
+}
+
+void sys_send_async(int receiver, char* msg, uint size) {
+    sc->type = SYS_SEND_ASYNC;
+    sys_msg_set(receiver, msg, size, 0);
     asm("ecall");
 }
 
@@ -22,6 +45,72 @@ void sys_recv(int from, int* sender, char* buf, uint size) {
     sc->type   = SYS_RECV;
     sc->sender = from;
     asm("ecall");
-    memcpy(buf, sc->content, size);
-    if (sender) *sender = sc->sender;
+    sys_msg_get(sender, buf, size);
+}
+
+void sys_call(int server, char* msg, uint size, char* buf, uint buf_size) {
+    sc->type = SYS_CALL;
+    sys_msg_set(server, msg, size, 0);
+    asm("ecall");
+    sys_msg_get(NULL, buf, buf_size);
+}
+
+void sys_reply_wait(int client, char* msg, uint size, int* sender, char* buf,
+                    uint buf_size) {
+    sc->type = SYS_REPLY_WAIT;
+    sys_msg_set(client, msg, size, 0);
+    asm("ecall");
+    sys_msg_get(sender, buf, buf_size);
+}
+
+void sys_reply_bulk_wait(int client, char* msg, uint size, int* sender,
+                         char* buf, uint buf_size) {
+    sc->type = SYS_REPLY_WAIT;
+    sys_msg_set(client, msg, size, 1);
+    asm("ecall");
+    sys_msg_get(sender, buf, buf_size);
+}
+
+static struct syscall_ring* ring = (struct syscall_ring*)SYSCALL_RING;
+
+struct ring_sqe* sys_ring_sqe() {
+    if (ring->sq_tail - ring->sq_head == SYSCALL_RING_ENTRIES) return NULL;
+    return &ring->sq[ring->sq_tail++ % SYSCALL_RING_ENTRIES];
+}
+
+void sys_ring_submit() {
+    sc->type = SYS_RING_SUBMIT;
+    asm("ecall");
+}
+
+int sys_ring_cqe(struct ring_cqe* cqe) {
+    if (ring->cq_head == ring->cq_tail) return -1;
+    memcpy(cqe, &ring->cq[ring->cq_head++ % SYSCALL_RING_ENTRIES], sizeof(*cqe));
+    return 0;
+}
+
+#define MTIME_BASE (CLINT_BASE + 0xBFF8)
+
+ulonglong sys_mtime() {
+    uint low, high;
+    do {
+        high = REGW(MTIME_BASE, 4);
+        low  = REGW(MTIME_BASE, 0);
+    } while (REGW(MTIME_BASE, 4) != high);
+
+    return (((ulonglong)high) << 32) | low;
+}
+
+void sys_sleep(uint usec) {
+    sc->type = SYS_SLEEP;
+    sc->usec = usec;
+    asm("ecall");
+}
+
+int sys_rt_set(uint period, uint budget) {
+    sc->type   = SYS_RT_SET;
+    sc->usec   = period;
+    sc->budget = budget;
+    asm("ecall");
+    return sc->retval;
 }
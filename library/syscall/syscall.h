@@ -6,15 +6,88 @@ enum syscall_type {
     SYS_UNUSED,
     SYS_RECV, /* 1 */
     SYS_SEND, /* 2 */
+    SYS_SLEEP, /* 3 */
+    SYS_CALL, /* 4 */
+    SYS_REPLY_WAIT, /* 5 */
+    SYS_SEND_ASYNC, /* 6 */
+    SYS_RING_SUBMIT, /* 7 */
+    SYS_RT_SET, /* 8 */
 };
 
-#define SYSCALL_MSG_LEN 1024
+#define SYSCALL_MSG_LEN  1024
+#define SYSCALL_BULK_LEN 4096 /* the SYSCALL_BULK page */
 struct syscall {
-    enum syscall_type type; /* SYS_SEND or SYS_RECV */
+    enum syscall_type type; /* SYS_SEND, SYS_RECV, etc. */
     int sender;             /* sender process ID    */
     int receiver;           /* receiver process ID  */
+    uint usec;              /* SYS_SLEEP duration, SYS_RT_SET period */
+    uint budget;            /* SYS_RT_SET budget in usec per period */
+    int retval;             /* SYS_RT_SET: set by the kernel */
+    uint bulk;              /* SYSCALL_BULK page moved with the message */
+    uint len;               /* bytes of content used by the message */
     char content[SYSCALL_MSG_LEN];
 };
+#define SYSCALL_HDR_LEN (sizeof(struct syscall) - SYSCALL_MSG_LEN)
 
+/* Only `size` bytes of msg are copied by the kernel, so keep it tight. */
 void sys_send(int receiver, char* msg, uint size);
+/* Like sys_send, and the SYSCALL_BULK page of the sender is moved to the
+ * receiver instead of copied (the sender gets the old page of the receiver).
+ * The receiver finds the payload at SYSCALL_BULK after sys_recv. */
+void sys_send_bulk(int receiver, char* msg, uint size);
 void sys_recv(int from, int* sender, char* buf, uint size);
+/* Like sys_send, but returns once the kernel has buffered the message for
+ * the receiver, and blocks only if the buffer of the receiver is full. */
+void sys_send_async(int receiver, char* msg, uint size);
+/* sys_send to a server and sys_recv its reply with a single trap. */
+void sys_call(int server, char* msg, uint size, char* buf, uint buf_size);
+/* sys_send a reply to client (skipped if client is GPID_UNUSED), and then
+ * sys_recv the next request from GPID_ALL with a single trap. */
+void sys_reply_wait(int client, char* msg, uint size, int* sender, char* buf,
+                    uint buf_size);
+void sys_reply_bulk_wait(int client, char* msg, uint size, int* sender,
+                         char* buf, uint buf_size);
+void sys_sleep(uint usec);
+/* Read mtime of the CLINT (MTIME_TICKS_PER_USEC ticks per usec), no trap. */
+ulonglong sys_mtime();
+/* Join the real-time (EDF) class with `budget` usec of CPU time in every
+ * `period` usec, or leave it if `budget` is 0. Returns -1 if the kernel
+ * cannot admit the process without overloading every allowed core. */
+int sys_rt_set(uint period, uint budget);
+
+/* Submission and completion rings in the SYSCALL_RING page. An app queues
+ * sends on the submission ring and runs them all with a single trap by
+ * sys_ring_submit. The kernel puts a completion on the completion ring for
+ * every submission, and stops early if the completion ring is full. */
+#define SYSCALL_RING_ENTRIES 16
+#define SYSCALL_RING_MSG_LEN 96
+struct ring_sqe {
+    enum syscall_type type; /* SYS_SEND, SYS_SEND_ASYNC or SYS_CALL */
+    int receiver;
+    uint len;               /* bytes of content used */
+    uint user_data;         /* copied to the completion */
+    char* reply_buf;        /* SYS_CALL: where to put the reply content */
+    uint reply_size;
+    char* bulk_buf;         /* SYS_CALL: where to put the SYSCALL_BULK page */
+    uint bulk_size;         /* of the reply, if the reply is a bulk message */
+    char content[SYSCALL_RING_MSG_LEN];
+};
+
+struct ring_cqe {
+    uint user_data;
+    int sender;             /* SYS_CALL: the process which replied, or
+                               GPID_UNUSED if reply_buf or bulk_buf is not
+                               in [APPS_ENTRY, APPS_STACK_TOP) */
+    uint len;               /* SYS_CALL: bytes of the reply content */
+};
+
+struct syscall_ring {
+    uint sq_head, sq_tail;  /* the kernel consumes, the app produces */
+    uint cq_head, cq_tail;  /* the app consumes, the kernel produces */
+    struct ring_sqe sq[SYSCALL_RING_ENTRIES];
+    struct ring_cqe cq[SYSCALL_RING_ENTRIES];
+};
+
+struct ring_sqe* sys_ring_sqe(); /* returns NULL if the ring is full */
+void sys_ring_submit();
+int sys_ring_cqe(struct ring_cqe* cqe); /* returns -1 if the ring is empty */
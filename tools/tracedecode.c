@@ -0,0 +1,114 @@
+/*
+ * (C) 2025, Cornell University
+ * All rights reserved.
+ *
+ * Description: decode the kernel trace dumped by the shell built-in `trace`
+ * Copy the terminal output into a file and run `./tracedecode < FILE`. It
+ * prints the events of all the rings ordered by time, and then the largest
+ * gaps between consecutive events on a ring, the latency from sys_send to
+ * sys_recv of each message, and the latency of each disk access.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define MAX_NEVENTS (16 * TRACE_NEVENTS)
+#define NOUTLIERS   10
+
+struct record {
+    unsigned int ring;
+    struct trace_event ev;
+} records[MAX_NEVENTS];
+int nrecords;
+
+char* names[TRACE_NTYPES] = {"unused", "trap",       "switch",
+                             "send",   "recv",       "wait",
+                             "alloc",  "free",       "disk_read",
+                             "disk_write", "disk_done"};
+
+struct outlier {
+    unsigned long long ticks;
+    int index; /* records[index] is where the latency ends */
+} gaps[NOUTLIERS], ipcs[NOUTLIERS], disks[NOUTLIERS];
+
+void outlier_add(struct outlier* top, unsigned long long ticks, int index) {
+    int i = NOUTLIERS - 1;
+    if (ticks <= top[i].ticks) return;
+    for (; i > 0 && top[i - 1].ticks < ticks; i--) top[i] = top[i - 1];
+    top[i].ticks = ticks;
+    top[i].index = index;
+}
+
+void outlier_print(char* title, struct outlier* top) {
+    printf("\n%s\n", title);
+    for (int i = 0; i < NOUTLIERS && top[i].ticks; i++) {
+        struct record* r = &records[top[i].index];
+        printf("  %10llu ticks, ending at %llu on ring %u (pid %d %s)\n",
+               top[i].ticks, r->ev.time, r->ring, r->ev.pid,
+               names[r->ev.type]);
+    }
+}
+
+int by_time(const void* a, const void* b) {
+    const struct record *x = a, *y = b;
+    return (x->ev.time > y->ev.time) - (x->ev.time < y->ev.time);
+}
+
+int main() {
+    char line[256];
+    while (fgets(line, sizeof(line), stdin) && nrecords < MAX_NEVENTS) {
+        char* p = strstr(line, "trace ");
+        unsigned int ring, hi, lo, type, pid, arg;
+        if (!p || sscanf(p, "trace %x %x %x %x %x %x", &ring, &hi, &lo, &type,
+                         &pid, &arg) != 6 || type >= TRACE_NTYPES)
+            continue;
+
+        struct record* r = &records[nrecords++];
+        r->ring    = ring;
+        r->ev.time = ((unsigned long long)hi << 32) | lo;
+        r->ev.type = type;
+        r->ev.pid  = (short)pid;
+        r->ev.arg  = arg;
+    }
+    qsort(records, nrecords, sizeof(struct record), by_time);
+
+    unsigned long long last_time[64] = {0};
+    for (int i = 0; i < nrecords; i++) {
+        struct record* r = &records[i];
+        printf("%14llu ring %u pid %3d %-10s %d\n", r->ev.time, r->ring,
+               r->ev.pid, names[r->ev.type], (int)r->ev.arg);
+
+        if (r->ring < 64) {
+            if (last_time[r->ring])
+                outlier_add(gaps, r->ev.time - last_time[r->ring], i);
+            last_time[r->ring] = r->ev.time;
+        }
+
+        /* Match a recv with the latest send of the same message. */
+        if (r->ev.type == TRACE_RECV)
+            for (int j = i - 1; j >= 0; j--)
+                if (records[j].ev.type == TRACE_SEND &&
+                    records[j].ev.pid == (short)r->ev.arg &&
+                    records[j].ev.arg == (unsigned short)r->ev.pid) {
+                    outlier_add(ipcs, r->ev.time - records[j].ev.time, i);
+                    break;
+                }
+
+        /* Match a disk_done with the disk access before it. */
+        if (r->ev.type == TRACE_DISK_DONE)
+            for (int j = i - 1; j >= 0; j--)
+                if (records[j].ev.type == TRACE_DISK_READ ||
+                    records[j].ev.type == TRACE_DISK_WRITE) {
+                    outlier_add(disks, r->ev.time - records[j].ev.time, i);
+                    break;
+                }
+    }
+
+    printf("\n%d events decoded\n", nrecords);
+    outlier_print("Largest gaps between events on a ring:", gaps);
+    outlier_print("Largest latency from send to recv:", ipcs);
+    outlier_print("Largest latency of disk accesses:", disks);
+    return 0;
+}